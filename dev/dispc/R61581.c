@@ -9,6 +9,7 @@
 #include "hw_conf.h"
 #if USE_R61581 != 0
 
+#include <stddef.h>
 #include "R61581.h"
 #include "hw/per/par.h"
 #include "hw/per/io.h"
@@ -21,6 +22,10 @@
 #define R61581_CMD_MODE     0
 #define R61581_DATA_MODE    1
 
+#ifndef R61581_RS_ADR
+#define R61581_RS_ADR   0   /*0: RS is a GPIO, else: parallel port address of the data (RS on an address line)*/
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -31,6 +36,7 @@
 static void r61581_io_init(void);
 static void r61581_reset(void);
 static void r61581_set_tft_spec(void);
+static void r61581_set_win(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
 static inline void r61581_cmd_mode(void);
 static inline void r61581_data_mode(void);
 static inline void r61581_cmd(uint8_t cmd);
@@ -112,20 +118,7 @@ void r61581_fill(color_t color)
     int32_t act_x2 = last_x2 > R61581_HOR_RES - 1 ? R61581_HOR_RES - 1 : last_x2;
     int32_t act_y2 = last_y2 > R61581_VER_RES - 1 ? R61581_VER_RES - 1 : last_y2;
 
-    //Set the rectangular area
-    r61581_cmd(0x002A);
-    r61581_data(act_x1 >> 8);
-    r61581_data(0x00FF & act_x1);
-    r61581_data(act_x2 >> 8);
-    r61581_data(0x00FF & act_x2);
-
-    r61581_cmd(0x002B);
-    r61581_data(act_y1 >> 8);
-    r61581_data(0x00FF & act_y1);
-    r61581_data(act_y2 >> 8);
-    r61581_data(0x00FF & act_y2);
-
-    r61581_cmd(0x2c);
+    r61581_set_win(act_x1, act_y1, act_x2, act_y2);
     
     uint16_t color16 = color_to16(color);
 
@@ -153,20 +146,7 @@ void r61581_map(color_t * color_p)
     int32_t act_y2 = last_y2 > R61581_VER_RES - 1 ? R61581_VER_RES - 1 : last_y2;
 
         
-    //Set the rectangular area
-    r61581_cmd(0x002A);
-    r61581_data(act_x1 >> 8);
-    r61581_data(0x00FF & act_x1);
-    r61581_data(act_x2 >> 8);
-    r61581_data(0x00FF & act_x2);
-
-    r61581_cmd(0x002B);
-    r61581_data(act_y1 >> 8);
-    r61581_data(0x00FF & act_y1);
-    r61581_data(act_y2 >> 8);
-    r61581_data(0x00FF & act_y2);
-
-    r61581_cmd(0x2c);
+    r61581_set_win(act_x1, act_y1, act_x2, act_y2);
 
     int16_t i;
     uint16_t act_w = act_x2 - act_x1 + 1;
@@ -181,15 +161,42 @@ void r61581_map(color_t * color_p)
     }
 #else
     int16_t j;
+    uint16_t c;
     for(i = act_y1; i <= act_y2; i++) {
-        for(j = 0; j <= act_x2 - act_x1 + 1; j++) {
-            par_wr(color_to16(color_p[j]));
-            color_p += last_w;
+        for(j = 0; j < act_w; j++) {
+            c = color_to16(color_p[j]);
+            par_wr_array(&c, 1);    /*A pixel is 2 cycles on 8 bit bus*/
         }
+        color_p += last_w;
     }
 #endif
 }
 
+/**
+ * Write a buffer to the area set by 'r61581_set_area' in the background.
+ * If the area is on the screen the buffer is sent by one 'par_wr_array_async'
+ * (with 16 bit colors) else 'r61581_map' is used.
+ * @param color_p pointer to the colors. Has to be valid until 'cb' is called.
+ * @param cb called when the buffer is sent, maybe from interrupt (can be NULL)
+ */
+void r61581_map_async(color_t * color_p, void (*cb)(void))
+{
+#if COLOR_DEPTH == 16
+    if(last_x1 >= 0 && last_y1 >= 0 && 
+       last_x2 <= R61581_HOR_RES - 1 && last_y2 <= R61581_VER_RES - 1) {
+        uint32_t size = (last_x2 - last_x1 + 1) * (last_y2 - last_y1 + 1);
+
+        r61581_set_win(last_x1, last_y1, last_x2, last_y2);
+        r61581_data_mode();
+        par_wr_array_async((uint16_t*)color_p, size, cb);
+        return;
+    }
+#endif
+
+    r61581_map(color_p);
+    if(cb != NULL) cb();
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -201,11 +208,17 @@ static void r61581_io_init(void)
 { 
     io_set_pin_dir(R61581_RST_PORT, R61581_RST_PIN, IO_DIR_OUT);
     io_set_pin_dir(R61581_BL_PORT, R61581_BL_PIN, IO_DIR_OUT);
+#if R61581_RS_ADR == 0
     io_set_pin_dir(R61581_RS_PORT, R61581_RS_PIN, IO_DIR_OUT);
+#endif
 
     io_set_pin(R61581_RST_PORT, R61581_RST_PIN, 1);
     io_set_pin(R61581_BL_PORT, R61581_BL_PIN, 0);
+#if R61581_RS_ADR == 0
     io_set_pin(R61581_RS_PORT, R61581_RS_PIN, R61581_CMD_MODE);
+#else
+    par_set_adr(0);
+#endif
     cmd_mode = true;
 }
 
@@ -353,13 +366,42 @@ static void r61581_set_tft_spec(void)
     tick_wait_ms(5);
 }
 
+/**
+ * Set the rectangular area to write
+ * @param x1 left coordinate
+ * @param y1 top coordinate
+ * @param x2 right coordinate
+ * @param y2 bottom coordinate
+ */
+static void r61581_set_win(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    r61581_cmd(0x002A);
+    r61581_data(x1 >> 8);
+    r61581_data(0x00FF & x1);
+    r61581_data(x2 >> 8);
+    r61581_data(0x00FF & x2);
+
+    r61581_cmd(0x002B);
+    r61581_data(y1 >> 8);
+    r61581_data(0x00FF & y1);
+    r61581_data(y2 >> 8);
+    r61581_data(0x00FF & y2);
+
+    r61581_cmd(0x2c);
+}
+
 /**
  * Command mode
  */
 static inline void r61581_cmd_mode(void)
 {
     if(cmd_mode == false) {
+#if R61581_RS_ADR == 0
+        while(par_busy() != false);     /*Don't change RS during an async. write*/
         io_set_pin(R61581_RS_PORT, R61581_RS_PIN, R61581_CMD_MODE);
+#else
+        par_set_adr(0);
+#endif
         cmd_mode = true;
     }
 }
@@ -370,7 +412,11 @@ static inline void r61581_cmd_mode(void)
 static inline void r61581_data_mode(void)
 {
     if(cmd_mode != false) {
+#if R61581_RS_ADR == 0
         io_set_pin(R61581_RS_PORT, R61581_RS_PIN, R61581_DATA_MODE);
+#else
+        par_set_adr(R61581_RS_ADR);
+#endif
         cmd_mode = false;
     }
 }
@@ -31,6 +31,7 @@ void r61581_init(void);
 void r61581_set_area(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
 void r61581_fill(color_t color);
 void r61581_map(color_t * color_p);
+void r61581_map_async(color_t * color_p, void (*cb)(void));
 /**********************
  *      MACROS
  **********************/
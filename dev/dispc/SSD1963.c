@@ -10,6 +10,7 @@
 #if USE_SSD1963 != 0
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "SSD1963.h"
 #include "hw/per/par.h"
 #include "hw/per/io.h"
@@ -22,6 +23,10 @@
 #define SSD1963_CMD_MODE     0
 #define SSD1963_DATA_MODE    1
 
+#ifndef SSD1963_RS_ADR
+#define SSD1963_RS_ADR   0   /*0: RS is a GPIO, else: parallel port address of the data (RS on an address line)*/
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -29,6 +34,7 @@
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static void ssd1963_set_win(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
 static inline void ssd1963_cmd_mode(void);
 static inline void ssd1963_data_mode(void);
 static inline void ssd1963_cmd(uint8_t cmd);
@@ -95,20 +101,7 @@ void ssd1963_fill(color_t color)
     int32_t act_x2 = last_x2 > SSD1963_HOR_RES - 1 ? SSD1963_HOR_RES - 1 : last_x2;
     int32_t act_y2 = last_y2 > SSD1963_VER_RES - 1 ? SSD1963_VER_RES - 1 : last_y2;
    
-    //Set the rectangular area
-    ssd1963_cmd(0x002A);
-    ssd1963_data(act_x1 >> 8);
-    ssd1963_data(0x00FF & act_x1);
-    ssd1963_data(act_x2 >> 8);
-    ssd1963_data(0x00FF & act_x2);
-
-    ssd1963_cmd(0x002B);
-    ssd1963_data(act_y1 >> 8);
-    ssd1963_data(0x00FF & act_y1);
-    ssd1963_data(act_y2 >> 8);
-    ssd1963_data(0x00FF & act_y2);
-
-    ssd1963_cmd(0x2c);
+    ssd1963_set_win(act_x1, act_y1, act_x2, act_y2);
     
     uint16_t color16 = color_to16(color);
 
@@ -132,20 +125,7 @@ void ssd1963_map(color_t * color_p)
     int32_t act_x2 = last_x2 > SSD1963_HOR_RES - 1 ? SSD1963_HOR_RES - 1 : last_x2;
     int32_t act_y2 = last_y2 > SSD1963_VER_RES - 1 ? SSD1963_VER_RES - 1 : last_y2;
    
-    //Set the rectangular area
-    ssd1963_cmd(0x002A);
-    ssd1963_data(act_x1 >> 8);
-    ssd1963_data(0x00FF & act_x1);
-    ssd1963_data(act_x2 >> 8);
-    ssd1963_data(0x00FF & act_x2);
-
-    ssd1963_cmd(0x002B);
-    ssd1963_data(act_y1 >> 8);
-    ssd1963_data(0x00FF & act_y1);
-    ssd1963_data(act_y2 >> 8);
-    ssd1963_data(0x00FF & act_y2);
-
-    ssd1963_cmd(0x2c);
+    ssd1963_set_win(act_x1, act_y1, act_x2, act_y2);
      int16_t i;
     uint16_t act_w = act_x2 - act_x1 + 1;
     uint16_t last_w = last_x2 - last_x1 + 1;
@@ -159,15 +139,42 @@ void ssd1963_map(color_t * color_p)
     }
 #else
     int16_t j;
+    uint16_t c;
     for(i = act_y1; i <= act_y2; i++) {
-        for(j = 0; j <= act_x2 - act_x1 + 1; j++) {
-            par_wr(color_to16(color_p[j]));
-            color_p += last_w;
+        for(j = 0; j < act_w; j++) {
+            c = color_to16(color_p[j]);
+            par_wr_array(&c, 1);    /*A pixel is 2 cycles on 8 bit bus*/
         }
+        color_p += last_w;
     }
 #endif
 }
 
+/**
+ * Write a buffer to the area set by 'ssd1963_set_area' in the background.
+ * If the area is on the screen the buffer is sent by one 'par_wr_array_async'
+ * (with 16 bit colors) else 'ssd1963_map' is used.
+ * @param color_p pointer to the colors. Has to be valid until 'cb' is called.
+ * @param cb called when the buffer is sent, maybe from interrupt (can be NULL)
+ */
+void ssd1963_map_async(color_t * color_p, void (*cb)(void))
+{
+#if COLOR_DEPTH == 16
+    if(last_x1 >= 0 && last_y1 >= 0 && 
+       last_x2 <= SSD1963_HOR_RES - 1 && last_y2 <= SSD1963_VER_RES - 1) {
+        uint32_t size = (last_x2 - last_x1 + 1) * (last_y2 - last_y1 + 1);
+
+        ssd1963_set_win(last_x1, last_y1, last_x2, last_y2);
+        ssd1963_data_mode();
+        par_wr_array_async((uint16_t*)color_p, size, cb);
+        return;
+    }
+#endif
+
+    ssd1963_map(color_p);
+    if(cb != NULL) cb();
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -176,10 +183,16 @@ static void ssd1963_io_init(void)
 {
     io_set_pin_dir(SSD1963_RST_PORT, SSD1963_RST_PIN, IO_DIR_OUT);   
     io_set_pin_dir(SSD1963_BL_PORT, SSD1963_BL_PIN, IO_DIR_OUT);
+#if SSD1963_RS_ADR == 0
     io_set_pin_dir(SSD1963_RS_PORT, SSD1963_RS_PIN, IO_DIR_OUT);
+#endif
     io_set_pin(SSD1963_RST_PORT, SSD1963_RST_PIN, 1);
     io_set_pin(SSD1963_BL_PORT, SSD1963_BL_PIN, 0);
+#if SSD1963_RS_ADR == 0
     io_set_pin(SSD1963_RS_PORT, SSD1963_RS_PIN, SSD1963_CMD_MODE);
+#else
+    par_set_adr(0);
+#endif
     cmd_mode = true;
 }
 
@@ -308,13 +321,42 @@ static void ssd1963_init_bl(void)
 }
 
 
+/**
+ * Set the rectangular area to write
+ * @param x1 left coordinate
+ * @param y1 top coordinate
+ * @param x2 right coordinate
+ * @param y2 bottom coordinate
+ */
+static void ssd1963_set_win(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    ssd1963_cmd(0x002A);
+    ssd1963_data(x1 >> 8);
+    ssd1963_data(0x00FF & x1);
+    ssd1963_data(x2 >> 8);
+    ssd1963_data(0x00FF & x2);
+
+    ssd1963_cmd(0x002B);
+    ssd1963_data(y1 >> 8);
+    ssd1963_data(0x00FF & y1);
+    ssd1963_data(y2 >> 8);
+    ssd1963_data(0x00FF & y2);
+
+    ssd1963_cmd(0x2c);
+}
+
 /**
  * Command mode
  */
 static inline void ssd1963_cmd_mode(void)
 {
     if(cmd_mode == false) {
+#if SSD1963_RS_ADR == 0
+        while(par_busy() != false);     /*Don't change RS during an async. write*/
         io_set_pin(SSD1963_RS_PORT, SSD1963_RS_PIN, SSD1963_CMD_MODE);
+#else
+        par_set_adr(0);
+#endif
         cmd_mode = true;
     }
 }
@@ -325,7 +367,11 @@ static inline void ssd1963_cmd_mode(void)
 static inline void ssd1963_data_mode(void)
 {
     if(cmd_mode != false) {
+#if SSD1963_RS_ADR == 0
         io_set_pin(SSD1963_RS_PORT, SSD1963_RS_PIN, SSD1963_DATA_MODE);
+#else
+        par_set_adr(SSD1963_RS_ADR);
+#endif
         cmd_mode = false;
     }
 }
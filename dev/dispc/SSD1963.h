@@ -31,6 +31,7 @@ void ssd1963_init(void);
 void ssd1963_set_area(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
 void ssd1963_fill(color_t  color);
 void ssd1963_map(color_t * color_p);
+void ssd1963_map_async(color_t * color_p, void (*cb)(void));
 
 /**********************
  *      MACROS
@@ -166,7 +166,7 @@ static void rdisp_flush(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
 //    pack.intense = 0x16;
 //       
 //    slip_len = slip_encode(slip_buf, &pack, sizeof(rdisp_packet_t));
-//    serial_send_force(RDISP_DRV, slip_buf, slip_len);
+//    serial_send_force(RDISP_DRV, slip_buf, slip_len, SERIAL_TOUT_INF);
 //
 //    return;
     
@@ -178,7 +178,7 @@ static void rdisp_flush(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
             pack.intense = disp_fb[x+ y * RDISP_HOR_RES] >> 2;
             
             slip_len = slip_encode(slip_buf, &pack, sizeof(rdisp_packet_t));
-            serial_send_force(RDISP_DRV, slip_buf, slip_len);
+            serial_send_force(RDISP_DRV, slip_buf, slip_len, SERIAL_TOUT_INF);
         }
     }
 }
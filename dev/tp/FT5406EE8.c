@@ -11,7 +11,7 @@
 
 #include "hw/per/i2c.h"
 #include "hw/per/io.h"
-#include "hw/per/tick"
+#include "hw/per/tick.h"
 #include "FT5406EE8.h"
 #include <stddef.h>
 #include <stdbool.h>
@@ -21,16 +21,36 @@
  *********************/
 #define FT5406EE8_I2C_ADR   0x38
 
-#define FT5406EE8_FINGER_MAX 10
+#define FT5406EE8_POINT_NUM  10   /*Touch points supported by the controller*/
+#define FT5406EE8_I2C_TOUT   10   /*Max. time of a sample read [ms]*/
+
+#ifndef FT5406EE8_HOR_RES
+#define FT5406EE8_HOR_RES   320
+#endif
+#ifndef FT5406EE8_VER_RES
+#define FT5406EE8_VER_RES   240
+#endif
+#define FT5406EE8_RAW_RES   2048  /*Coordinate range of the controller*/
 
 /*Register adresses*/
 #define FT5406EE8_REG_DEVICE_MODE 0x00
 #define FT5406EE8_REG_GEST_ID     0x01
 #define FT5406EE8_REG_TD_STATUS   0x02
+#define FT5406EE8_REG_YH          0x03      /*First touch point. The next one is 6 bytes later*/
+#define FT5406EE8_REG_YL          0x04
 #define FT5406EE8_REG_XH          0x05
 #define FT5406EE8_REG_XL          0x06
-#define FT5406EE8_REG_YH          0x03
-#define FT5406EE8_REG_YL          0x04
+
+#define FT5406EE8_POINT_SIZE      6         /*Size of the registers of a touch point*/
+
+/*Event flag in YH[7:6]*/
+#define FT5406EE8_EVENT_DOWN      0
+#define FT5406EE8_EVENT_UP        1
+#define FT5406EE8_EVENT_CONTACT   2
+
+#if FT5406EE8_FINGER_MAX < 1 || FT5406EE8_FINGER_MAX > FT5406EE8_POINT_NUM
+#error "FT5406EE8_FINGER_MAX must be 1..10"
+#endif
 
 /**********************
  *      TYPEDEFS
@@ -39,9 +59,7 @@
 /**********************
  *  STATIC PROTOTYPES
  **********************/
-
-static bool ft5406ee8_get_touch_num(void);
-static bool ft5406ee8_read_finger1(int16_t * x,  int16_t * y);
+static bool ft5406ee8_parse_point(const uint8_t * reg, ft5406ee8_point_t * point);
 
 /**********************
  *  STATIC VARIABLES
@@ -63,114 +81,97 @@ void ft5406ee8_init(void)
 
 }
 
+/**
+ * Get the coordinates of the first finger
+ * @param x store the x coordinate here
+ * @param y store the y coordinate here
+ * @return true: the screen is touched, false: not touched (x and y are the last valid coordinates)
+ */
 bool ft5406ee8_get(int16_t * x, int16_t * y)
 {   
     static int16_t x_last;
     static int16_t y_last;
-    bool valid = true;   
+    ft5406ee8_point_t point;
+    bool valid;
     
-    valid = ft5406ee8_get_touch_num();
-    if(valid == true) {
-        valid = ft5406ee8_read_finger1(x, y);
-    }
+    valid = ft5406ee8_get_multi(&point, 1) != 0 ? true : false;
      
-     if(valid == true) {
-        *x = (uint32_t)((uint32_t)*x * 320) / 2048;
-        *y = (uint32_t)((uint32_t)*y * 240) / 2048; 
-         
-         
-        x_last = *x;
-        y_last = *y;
-     }
-     else {
-        *x = x_last;
-        *y = y_last;
+    if(valid == true) {
+        x_last = point.x;
+        y_last = point.y;
     }
+    
+    *x = x_last;
+    *y = y_last;
 
     return valid;
 }
 
-/**********************
- *   STATIC FUNCTIONS
- **********************/
-
-static bool ft5406ee8_get_touch_num(void)
+/**
+ * Read every touch point in one transfer. TD_STATUS and the point registers
+ * are read by a single auto-increment read.
+ * @param points store the touched points here
+ * @param max size of 'points' (only the first FT5406EE8_FINGER_MAX points are read)
+ * @return number of touched points stored in 'points'
+ */
+uint8_t ft5406ee8_get_multi(ft5406ee8_point_t * points, uint8_t max)
 {
-    bool ok = true;
+    uint8_t buf[1 + FT5406EE8_FINGER_MAX * FT5406EE8_POINT_SIZE];
     uint8_t t_num;
+    uint8_t i;
+    uint8_t cnt = 0;
     hw_res_t res;
     
-    /* Read number of touched points */
-    res = i2c_read(FT540EE8_I2C_DRV, 
-                     FT5406EE8_I2C_ADR, FT5406EE8_REG_TD_STATUS, &t_num, 1);         
+    if(max > FT5406EE8_FINGER_MAX) max = FT5406EE8_FINGER_MAX;
+    if(max == 0) return 0;
     
+    res = i2c_read(FT540EE8_I2C_DRV, FT5406EE8_I2C_ADR, FT5406EE8_REG_TD_STATUS, 
+                   buf, 1 + max * FT5406EE8_POINT_SIZE, FT5406EE8_I2C_TOUT);
     if(res != HW_RES_OK) {
-        ok = false;
         /*TODO log device error*/
+        return 0;
     }
     
     /* Error if not touched or too much finger */
-    if (t_num > FT5406EE8_FINGER_MAX || t_num == 0){
-        ok = false;
+    t_num = buf[0] & 0x0F;
+    if(t_num > FT5406EE8_POINT_NUM) return 0;
+    if(t_num > max) t_num = max;
+    
+    for(i = 0; i < t_num; i++) {
+        if(ft5406ee8_parse_point(&buf[1 + i * FT5406EE8_POINT_SIZE], &points[cnt]) != false) {
+            cnt++;
+        }
     }
-
-    return ok;
+    
+    return cnt;
 }
 
-static bool ft5406ee8_read_finger1(int16_t * x, int16_t * y)
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Process the registers of a touch point
+ * @param reg pointer to the YH register of the point (the next registers follow it)
+ * @param point store the scaled coordinates and the touch ID here
+ * @return true: valid point, false: the finger is released or no event
+ */
+static bool ft5406ee8_parse_point(const uint8_t * reg, ft5406ee8_point_t * point)
 {
-    bool valid = true;
-    hw_res_t res = HW_RES_OK;
+    uint8_t event = (reg[FT5406EE8_REG_YH - FT5406EE8_REG_YH] >> 6) & 0x03;
     
-    uint8_t temp_xH = 0;
-    uint8_t temp_xL = 0;
-    uint8_t temp_yH = 0;
-    uint8_t temp_yL = 0;
+    if(event != FT5406EE8_EVENT_DOWN && event != FT5406EE8_EVENT_CONTACT) return false;
     
-    /*Read Y High and low byte*/
-    res = i2c_read(FT540EE8_I2C_DRV, 
-                   FT5406EE8_I2C_ADR, FT5406EE8_REG_YH, &temp_yH, 1);
-
-    if(res == HW_RES_OK) {
-        res = i2c_read(FT540EE8_I2C_DRV, 
-                       FT5406EE8_I2C_ADR, FT5406EE8_REG_YL, &temp_yL, 1);
-    } else {
-        valid = false;
-    }
-    
-    /*The upper two bit must be 2 on valid press*/
-    if(valid != false && ((temp_yH >> 6) & 0xFF) != 2) {
-        valid = false;    /*mark the error*/
-    }
-    
-    /*Read X High and low byte*/
-    if(valid != false) {
-        res = i2c_read(FT540EE8_I2C_DRV, 
-                           FT5406EE8_I2C_ADR, FT5406EE8_REG_XH, &temp_xH, 1); 
-        if(res == HW_RES_OK) {
-            res = i2c_read(FT540EE8_I2C_DRV, 
-                           FT5406EE8_I2C_ADR, FT5406EE8_REG_XL, &temp_xL, 1);   
-        } else {
-            valid = false;
-        }
-    }       
+    uint32_t y = ((reg[FT5406EE8_REG_YH - FT5406EE8_REG_YH] & 0x0F) << 8) + 
+                   reg[FT5406EE8_REG_YL - FT5406EE8_REG_YH];
+    uint32_t x = ((reg[FT5406EE8_REG_XH - FT5406EE8_REG_YH] & 0x0F) << 8) + 
+                   reg[FT5406EE8_REG_XL - FT5406EE8_REG_YH];
     
-    /*Save the result*/
-    if(valid != false) {
-        *x = (temp_xH & 0x0F) << 8;
-        *x += temp_xL;
-        *y = (temp_yH & 0x0F) << 8;
-        *y += temp_yL;
-    } else {
-        *x = 0;
-        *y = 0;
-    }
+    point->x = (x * FT5406EE8_HOR_RES) / FT5406EE8_RAW_RES;
+    point->y = (y * FT5406EE8_VER_RES) / FT5406EE8_RAW_RES;
+    point->id = reg[FT5406EE8_REG_XH - FT5406EE8_REG_YH] >> 4;
     
-    if(res != HW_RES_OK) {
-        /*TODO Log device error*/
-    }
-    
-    return valid;
+    return true;
 }
 
 #endif
@@ -13,12 +13,15 @@
 #if USE_FT5406EE8 != 0
 
 #include "hw/hw.h"
+#include <stdint.h>
+#include <stdbool.h>
 
 /*********************
  *      DEFINES
  *********************/
-
-
+#ifndef FT5406EE8_FINGER_MAX
+#define FT5406EE8_FINGER_MAX 5
+#endif
 
 /***********************************/
 /********** DEVICE MODES ***********/
@@ -37,12 +40,19 @@
 /**********************
  *      TYPEDEFS
  **********************/
+typedef struct
+{
+    int16_t x;
+    int16_t y;
+    uint8_t id;     /*Touch ID from the controller. Keeps its value while the finger is down*/
+}ft5406ee8_point_t;
 
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
 void ft5406ee8_init(void);
 bool ft5406ee8_get(int16_t * x, int16_t * y);
+uint8_t ft5406ee8_get_multi(ft5406ee8_point_t * points, uint8_t max);
 
 /**********************
  *      MACROS
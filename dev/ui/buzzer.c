@@ -9,14 +9,49 @@
 #include "hw_conf.h"
 #if USE_BUZZER != 0
 
+#include <stddef.h>
 #include "buzzer.h"
 #include "hw/per/tick.h"
 #include "hw/per/io.h"
+#include "hw/per/tmr.h"
 
 
 /*********************
  *      DEFINES
  *********************/
+#ifndef BUZZER_BEEP_FREQ
+#define BUZZER_BEEP_FREQ    2000    /*Tone of 'buzzer_beep' and 'buzzer_on' with BUZZER_EXT_DRIVE [Hz]*/
+#endif
+
+#define BUZZER_PWM_HALF     0x8000  /*50 % duty cycle for the loudest tone*/
+
+#if BUZZER_EXT_DRIVE != 0
+/*The timers are enum values: map them to numbers and to their TMRx_EN to check them here*/
+#define HW_TMR1_ID  1
+#define HW_TMR2_ID  2
+#define HW_TMR3_ID  3
+#define HW_TMR4_ID  4
+#define HW_TMR5_ID  5
+#define HW_TMR6_ID  6
+#define HW_TMR1_EN  TMR1_EN
+#define HW_TMR2_EN  TMR2_EN
+#define HW_TMR3_EN  TMR3_EN
+#define HW_TMR4_EN  TMR4_EN
+#define HW_TMR5_EN  TMR5_EN
+#define HW_TMR6_EN  TMR6_EN
+#define BUZZER_TMR_ID_(t)   t##_ID
+#define BUZZER_TMR_ID(t)    BUZZER_TMR_ID_(t)
+#define BUZZER_TMR_EN_(t)   t##_EN
+#define BUZZER_TMR_EN(t)    BUZZER_TMR_EN_(t)
+
+#if BUZZER_TMR_ID(BUZZER_TMR) == BUZZER_TMR_ID(TICK_TIMER)
+#error "BUZZER_TMR can't be the TICK_TIMER"
+#endif
+
+#if BUZZER_TMR_EN(BUZZER_TMR) == 0
+#error "BUZZER_TMR is not enabled (TMRx_EN)"
+#endif
+#endif
 
 /**********************
  *      TYPEDEFS
@@ -25,10 +60,25 @@
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static void buzzer_step_cb(void * ctx);
+static void buzzer_tone(uint16_t freq);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
+static tick_tmr_t step_tmr;
+static const buzzer_step_t * pat_start;     /*The playing pattern*/
+static const buzzer_step_t * pat_act;       /*The playing step*/
+#if BUZZER_EXT_DRIVE != 0
+static bool tone_on;
+#endif
+
+static const buzzer_step_t beep_pattern[] =
+{
+    {BUZZER_BEEP_FREQ, BUZZER_BEEP_ON_TIME},
+    {0, BUZZER_BEEP_OFF_TIME},
+    BUZZER_STEP_END,
+};
 
 /**********************
  *      MACROS
@@ -44,6 +94,14 @@
 void buzzer_init(void)
 {
     io_set_pin_dir(BUZZER_PORT, BUZZER_PIN, IO_DIR_OUT);
+
+#if BUZZER_EXT_DRIVE != 0
+    tmr_set_period(BUZZER_TMR, 1000000 / BUZZER_BEEP_FREQ);
+    tmr_pwm_init(BUZZER_TMR, BUZZER_PWM_CH);
+    tmr_run(BUZZER_TMR, true);
+#endif
+
+    tick_tmr_init(&step_tmr, buzzer_step_cb, NULL);
     
     buzzer_off();
 }
@@ -53,7 +111,9 @@ void buzzer_init(void)
  */
 void buzzer_on(void)
 {
-#if BUZZER_INV == 0
+#if BUZZER_EXT_DRIVE != 0
+    buzzer_tone(BUZZER_BEEP_FREQ);
+#elif BUZZER_INV == 0
     io_set_pin(BUZZER_PORT, BUZZER_PIN, 1);
 #else
     io_set_pin(BUZZER_PORT, BUZZER_PIN, 0);
@@ -65,7 +125,9 @@ void buzzer_on(void)
  */
 void buzzer_off(void)
 {
-#if BUZZER_INV == 0
+#if BUZZER_EXT_DRIVE != 0
+    buzzer_tone(0);
+#elif BUZZER_INV == 0
     io_set_pin(BUZZER_PORT, BUZZER_PIN, 0);
 #else
     io_set_pin(BUZZER_PORT, BUZZER_PIN, 1);
@@ -77,35 +139,108 @@ void buzzer_off(void)
  */
 void buzzer_toggle(void)
 {
+#if BUZZER_EXT_DRIVE != 0
+    if(tone_on == false) buzzer_on();
+    else buzzer_off();
+#else
     if(io_get_pin(BUZZER_PORT, BUZZER_PIN) == 0) io_set_pin(BUZZER_PORT, BUZZER_PIN, 1);
     else io_set_pin(BUZZER_PORT, BUZZER_PIN, 0);
+#endif
 }
 
 /**
- * Make a beep with the buzzer. (Blocking wait)
+ * Make a beep with the buzzer. Returns immediately, the beep is played from the tick.
  */
 void buzzer_beep(void)
 {
-    buzzer_on();
-    tick_wait_ms(BUZZER_BEEP_ON_TIME);
-    buzzer_off();
-    tick_wait_ms(BUZZER_BEEP_OFF_TIME);
+    buzzer_play(beep_pattern);
 }
 
-#if BUZZER_EXT_DRIVE != 0
-void buzzer_play(const * uint8_t pattern_p)
+/**
+ * Play a pattern in the background. The steps are sequenced from a tick timer.
+ * A playing pattern is replaced.
+ * @param pattern pointer to an array of steps closed by BUZZER_STEP_END or BUZZER_STEP_REPEAT
+ *                (only the pointer is saved, has to be valid while playing)
+ */
+void buzzer_play(const buzzer_step_t * pattern)
 {
-    
+    buzzer_stop();
+
+    if(pattern == NULL || pattern[0].time == 0) return;
+
+    pat_start = pattern;
+    pat_act = pattern;
+    buzzer_tone(pattern[0].freq);
+    tick_tmr_start(&step_tmr, pattern[0].time, 0);
 }
 
+/**
+ * Stop the playing pattern and turn off the buzzer
+ */
 void buzzer_stop(void)
 {
-    
+    tick_tmr_stop(&step_tmr);
+    pat_act = NULL;
+    buzzer_off();
+}
+
+/**
+ * Check the pattern player
+ * @return true: a pattern is playing
+ */
+bool buzzer_busy(void)
+{
+    return tick_tmr_act(&step_tmr);
 }
 
-#endif /*BUZZER_EXT_DRIVE*/
 /**********************
  *   STATIC FUNCTIONS
  **********************/
 
+/**
+ * Go to the next step of the pattern (called from the tick interrupt)
+ * @param ctx unused
+ */
+static void buzzer_step_cb(void * ctx)
+{
+    (void) ctx;
+
+    if(pat_act == NULL) return;
+
+    pat_act++;
+    if(pat_act->time == 0) {
+        if(pat_act->freq != BUZZER_FREQ_REPEAT) {
+            pat_act = NULL;
+            buzzer_off();
+            return;
+        }
+        pat_act = pat_start;
+    }
+
+    buzzer_tone(pat_act->freq);
+    tick_tmr_start(&step_tmr, pat_act->time, 0);
+}
+
+/**
+ * Sound a tone or silence
+ * @param freq frequency of the tone [Hz] (only on/off without BUZZER_EXT_DRIVE), 0: silence
+ */
+static void buzzer_tone(uint16_t freq)
+{
+#if BUZZER_EXT_DRIVE != 0
+    if(freq == 0) {
+        tmr_pwm_set(BUZZER_PWM_CH, 0);
+        tone_on = false;
+    } else {
+        tmr_set_period(BUZZER_TMR, 1000000 / freq);
+        tmr_set_value(BUZZER_TMR, 0);   /*Else a counter above the new period runs until the overflow*/
+        tmr_pwm_set(BUZZER_PWM_CH, BUZZER_PWM_HALF);
+        tone_on = true;
+    }
+#else
+    if(freq == 0) buzzer_off();
+    else buzzer_on();
+#endif
+}
+
 #endif /*USE_BUZZER*/
\ No newline at end of file
@@ -13,13 +13,25 @@
 #if USE_BUZZER != 0
 
 #include <stdint.h>
+#include <stdbool.h>
+
 /*********************
  *      DEFINES
  *********************/
+#define BUZZER_FREQ_REPEAT  0xFFFF  /*'freq' of a closing step to restart the pattern*/
+
+#define BUZZER_STEP_END     {0, 0}                      /*Close a pattern*/
+#define BUZZER_STEP_REPEAT  {BUZZER_FREQ_REPEAT, 0}     /*Close a pattern and play it again*/
 
 /**********************
  *      TYPEDEFS
  **********************/
+/*A step of a pattern. An array of steps has to be closed by BUZZER_STEP_END or BUZZER_STEP_REPEAT*/
+typedef struct
+{
+    uint16_t freq;      /*Tone [Hz], 0: silence (only on/off without BUZZER_EXT_DRIVE)*/
+    uint16_t time;      /*Length of the step [ms], 0: end of the pattern*/
+}buzzer_step_t;
 
 /**********************
  * GLOBAL PROTOTYPES
@@ -30,11 +42,9 @@ void buzzer_on(void);
 void buzzer_off(void);
 void buzzer_toggle(void);
 void buzzer_beep(void);
-
-#if BUZZER_EXT_DRIVE != 0
-void buzzer_play(const * uint8_t pattern_p);
+void buzzer_play(const buzzer_step_t * pattern);
 void buzzer_stop(void);
-#endif
+bool buzzer_busy(void);
 
 /**********************
  *      MACROS
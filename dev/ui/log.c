@@ -151,7 +151,7 @@ void log_err(const char * path, const char * func_name, const char * format, ...
 static void log_wr(const char * txt)
 {
 #if LOG_USE_SERIAL != 0
-    serial_send_force(LOG_SERIAL_DRV, txt, strlen(txt));
+    serial_send_force(LOG_SERIAL_DRV, txt, strlen(txt), SERIAL_TOUT_INF);
 #endif
 
 #if LOG_USE_PRINTF != 0
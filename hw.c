@@ -11,6 +11,7 @@
 #include "per/tmr.h"
 #include "per/tick.h"
 #include "per/serial.h"
+#include "per/frame.h"
 #include "per/par.h"
 #include "per/spi.h"
 #include "per/i2c.h"
@@ -70,6 +71,10 @@ void per_init(void)
     serial_init();
 #endif
 
+#if USE_FRAME != 0 && USE_SERIAL != 0
+    frame_init();
+#endif
+
 #if USE_PARALLEL != 0
     par_init();
 #endif
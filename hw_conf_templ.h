@@ -20,6 +20,9 @@
 #define PSP_PIC32MX        0
 #define PSP_PIC32MZ        0
 #define PSP_PC	       	   0
+#define PSP_PC_VTIME       0    /*1: virtual time on PC. The waits and the simulated buses don't sleep (requires USE_TMR)*/
+                                /*Only the waits, the simulated buses and 'task_run' (if the tasks only wait) let the time pass:
+                                 *a main loop polling 'tick_get' without them spins at a constant time*/
 
 /*-----------
  *   Clock
@@ -77,6 +80,8 @@
 #if TMR6_EN     !=  0
 #define TMR6_PRIO   HW_INT_PRIO_MID
 #endif  /*TMR6_EN*/
+
+#define TMR_IC_PRIO HW_INT_PRIO_OFF /*Input capture interrupts (HW_INT_PRIO_OFF: no input capture)*/
 #endif  /*USE_TMR*/
 
 /*----------------
@@ -85,13 +90,19 @@
 #define USE_TICK         1
 #if USE_TICK != 0
 #define TICK_FUNC_NUM 16
-#define TICK_US_BASE     5  /*Adjust the 'tick_wait_us' functions */
+#define TICK_WHEEL_SIZE  32 /*Slots of the software timer wheel (power of 2)*/
+#define TICK_US_BASE     5  /*Initial guess for 'tick_wait_us' (calibrated in 'tick_init')*/
 #define TICK_TIMER		HW_TMR2
 #else   /*Without tick a very simple wait functions can be enabled*/
 #define TICK_BLOCK_WAIT  1   /*Enable simple blocking wait functions*/
 #define TICK_US_BASE     5   /*Adjust the 'tick_wait_us' functions */
 #endif /*USE_TICK*/
 
+/*---------------------------
+ * Task (cooperative, on TICK)
+ *--------------------------*/
+#define USE_TASK         0
+
 /*-----------------
  * SERIAL (UART)
  *----------------*/
@@ -102,23 +113,50 @@
 #define SERIAL1_PRIO       HW_INT_PRIO_OFF /*HW_INT_PRIO_OFF to disable module*/
 #define SERIAL1_BUF_SIZE   0				 /*0: disable module*/
 #define SERIAL1_MODE       (SERIAL_MODE_BASIC)
+#define SERIAL1_RTS_PORT   IO_PORTX   /*Software RTS (SERIAL_MODE_RTS_EN), IO_PORTX: UxRTS pin*/
+#define SERIAL1_RTS_PIN    IO_PINX
+#define SERIAL1_DE_PORT    IO_PORTX   /*RS-485 driver enable (SERIAL_MODE_RS485)*/
+#define SERIAL1_DE_PIN     IO_PINX
 
 /*SERAL2*/
 #define SERIAL2_PRIO       HW_INT_PRIO_OFF /*HW_INT_PRIO_OFF to disable module*/
 #define SERIAL2_BUF_SIZE   0
 #define SERIAL2_MODE       (SERIAL_MODE_BASIC)
+#define SERIAL2_RTS_PORT   IO_PORTX   /*Software RTS (SERIAL_MODE_RTS_EN), IO_PORTX: UxRTS pin*/
+#define SERIAL2_RTS_PIN    IO_PINX
+#define SERIAL2_DE_PORT    IO_PORTX   /*RS-485 driver enable (SERIAL_MODE_RS485)*/
+#define SERIAL2_DE_PIN     IO_PINX
 
 /*SERIAL3*/
 #define SERIAL3_PRIO       HW_INT_PRIO_OFF /*HW_INT_PRIO_OFF to disable module*/
 #define SERIAL3_BUF_SIZE   0
 #define SERIAL3_MODE       (SERIAL_MODE_BASIC)
+#define SERIAL3_RTS_PORT   IO_PORTX   /*Software RTS (SERIAL_MODE_RTS_EN), IO_PORTX: UxRTS pin*/
+#define SERIAL3_RTS_PIN    IO_PINX
+#define SERIAL3_DE_PORT    IO_PORTX   /*RS-485 driver enable (SERIAL_MODE_RS485)*/
+#define SERIAL3_DE_PIN     IO_PINX
 
 /*SERIAL4*/
 #define SERIAL4_PRIO       HW_INT_PRIO_OFF /*HW_INT_PRIO_OFF to disable*/
 #define SERIAL4_BUF_SIZE   0
 #define SERIAL4_MODE       (SERIAL_MODE_BASIC)
+#define SERIAL4_RTS_PORT   IO_PORTX   /*Software RTS (SERIAL_MODE_RTS_EN), IO_PORTX: UxRTS pin*/
+#define SERIAL4_RTS_PIN    IO_PINX
+#define SERIAL4_DE_PORT    IO_PORTX   /*RS-485 driver enable (SERIAL_MODE_RS485)*/
+#define SERIAL4_DE_PIN     IO_PINX
+
+#define SERIAL_RTS_WATERMARK 8   /*Release the software RTS below this free space in rx buffer*/
+#define SERIAL_RS485_GUARD_US 0  /*Hold DE this long before the first and after the last bit [us]*/
 #endif /*USE_SERIAL*/
 
+/*-------------------------------
+ * Frame (COBS + CRC16 on SERIAL)
+ *------------------------------*/
+#define USE_FRAME         0
+#if USE_FRAME != 0
+#define FRAME_BUF_SIZE    256   /*Max. length of an encoded frame per serial module*/
+#endif /*USE_FRAME*/
+
 
 /*-----------
  *   SPI 
@@ -207,9 +245,25 @@
 
 /*I2C1*/
 #define I2C1_BAUD       0 /* 0: disable the module */   
+#define I2C1_PRIO       HW_INT_PRIO_OFF /*Interrupt for 'i2c_xfer_async' (HW_INT_PRIO_OFF: disable)*/
+#define I2C1_SW         0 /*1: bit-banged on the pins below (I2C1_BAUD is used too)*/
+#define I2C1_SCL_PORT   IO_PORTX  /*With hardware I2C the pins are used for bus recovery*/
+#define I2C1_SCL_PIN    IO_PINX
+#define I2C1_SDA_PORT   IO_PORTX
+#define I2C1_SDA_PIN    IO_PINX
 
 /*I2C2*/
 #define I2C2_BAUD       0   
+#define I2C2_PRIO       HW_INT_PRIO_OFF
+#define I2C2_SW         0
+#define I2C2_SCL_PORT   IO_PORTX
+#define I2C2_SCL_PIN    IO_PINX
+#define I2C2_SDA_PORT   IO_PORTX
+#define I2C2_SDA_PIN    IO_PINX
+
+#define I2C_ERR_MAX     3   /*Suspend a bus after this many failed transfers in a row (0: never)*/
+#define I2C_ERR_BACKOFF 100 /*Time to suspend a failing bus [ms]*/
+#define I2C_ASYNC_TOUT  50  /*An asynchronous transaction is aborted with HW_RES_TOUT after this [ms]*/
 #endif /*USE_I2C*/
 
 /*--------------
@@ -221,11 +275,15 @@
 #define PAR_CS1_PIN      IO_PINX
 #define PAR_CS2_PORT     IO_PORTX
 #define PAR_CS2_PIN      IO_PINX
+#define PAR_WIDTH        16     /*Data bus width: 8 or 16 (16 bit words are sent MSB first on 8 bit bus)*/
+#define PAR_MODE         PAR_MODE_8080  /*PAR_MODE_8080: RD/WR strobes, PAR_MODE_6800: R/W on RD pin, E on WR pin*/
 #define PAR_SW           0
 #if PAR_SW == 0     /*Hw par. settings*/
 #define PAR_WAITB        1      /*Begin wait cycles (>=1)*/
 #define PAR_WAITM        1      /*Middle wait cycles (>=1)*/
 #define PAR_WAITE        1      /*End wait cycles (>=1)*/
+#define PAR_DMA_PRIO     HW_INT_PRIO_OFF /*DMA for 'par_wr_array_async' (OFF: blocking)*/
+#define PAR_ADR_EN       0x0000 /*PMA pins used as address lines (PMAEN), e.g. 0x0001: PMA0*/
 #else               /*Sw par. settings*/
 #define PARSW_DATA_PORT   IO_PORTX
 #define PARSW_ADR_PORT    IO_PORTX
@@ -307,7 +365,12 @@
 #define BUZZER_INV  0
 #define BUZZER_BEEP_ON_TIME 200
 #define BUZZER_BEEP_OFF_TIME 100
-#define BUZZER_EXT_DRIVE    0  /*Not supported yet*/
+#define BUZZER_BEEP_FREQ    2000    /*Tone of the beep with BUZZER_EXT_DRIVE [Hz]*/
+#define BUZZER_EXT_DRIVE    0  /*1: passive buzzer, the tones are made by PWM*/
+#if BUZZER_EXT_DRIVE != 0
+#define BUZZER_TMR          HW_TMR3     /*Time base of the tones (not TICK_TIMER, enable it with TMRx_EN)*/
+#define BUZZER_PWM_CH       HW_TMR_CH1  /*Output compare channel on BUZZER_PIN*/
+#endif
 #endif
 
 /*-----------
@@ -339,6 +402,9 @@
 #define USE_SSD1963   0
 #if USE_SSD1963 != 0
 #define SSD1963_PAR_CS    PAR_CSX
+#define SSD1963_RS_PORT   IO_PORTX
+#define SSD1963_RS_PIN    IO_PINX
+#define SSD1963_RS_ADR    0         /*0: RS on RS_PORT/PIN, else: address to set RS (e.g. 1: RS on PMA0)*/
 #define SSD1963_RST_PORT  IO_PORTX
 #define SSD1963_RST_PIN   IO_PINX
 #define SSD1963_BL_PORT   IO_PORTX
@@ -369,6 +435,7 @@
 #define R61581_PAR_CS    PAR_CSX
 #define R61581_RS_PORT   IO_PORTX
 #define R61581_RS_PIN    IO_PINX
+#define R61581_RS_ADR    0         /*0: RS on RS_PORT/PIN, else: address to set RS (e.g. 1: RS on PMA0)*/
 #define R61581_RST_PORT  IO_PORTX
 #define R61581_RST_PIN   IO_PINX
 #define R61581_RST_PORT  IO_PORTX
@@ -434,6 +501,9 @@
 #define USE_FT5406EE8    0
 #if USE_FT5406EE8 != 0
 #define FT540EE8_I2C_DRV    HW_I2C1
+#define FT5406EE8_HOR_RES    320
+#define FT5406EE8_VER_RES    240
+#define FT5406EE8_FINGER_MAX 5      /*Touch points to read in a sample (1..10)*/
 #endif
 
 /*-------------------------------
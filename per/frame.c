@@ -0,0 +1,384 @@
+/**
+ * @file frame.c
+ * Packet framing on serial links: COBS encoding with a 0x00 delimiter
+ * and a CRC-16 (CCITT, 0x1021 poly, 0xFFFF init) appended to every frame.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "hw_conf.h"
+#if USE_FRAME != 0 && USE_SERIAL != 0
+
+#include <stddef.h>
+#include "frame.h"
+#include "serial.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define FRAME_COBS_BLOCK_MAX    254     /*Max. number of non-zero bytes in a COBS block*/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+    uint8_t buf[FRAME_BUF_SIZE];
+    uint16_t idx;
+    bool ovf;
+    void (*cb)(serial_t id, uint8_t * data, uint16_t len);
+    frame_stat_t stat;
+}m_dsc_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static uint8_t frame_get_byte(const uint8_t * data, uint16_t len, const uint8_t * crc, uint16_t i);
+static hw_res_t frame_put(serial_t id, uint8_t byte);
+static hw_res_t frame_put_array(serial_t id, const uint8_t * data, uint16_t len,
+                                const uint8_t * crc, uint16_t start, uint16_t num);
+static int32_t frame_cobs_decode(uint8_t * buf, uint16_t len);
+static void frame_process(serial_t id);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static m_dsc_t m_dsc[HW_SERIAL_NUM];
+
+static const uint16_t crc16_tbl[256] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0,
+};
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Initialize the framing layer
+ */
+void frame_init(void)
+{
+    serial_t id;
+    for(id = HW_SERIAL1; id < HW_SERIAL_NUM; id++) {
+        m_dsc[id].idx = 0;
+        m_dsc[id].ovf = false;
+        m_dsc[id].cb = NULL;
+        m_dsc[id].stat.rec = 0;
+        m_dsc[id].stat.crc_err = 0;
+        m_dsc[id].stat.cobs_err = 0;
+        m_dsc[id].stat.ovf_err = 0;
+    }
+}
+
+/**
+ * Set a function to call when a valid frame is received.
+ * The data passed to the callback is valid only until the callback returns.
+ * @param id the id of an SERIAL module
+ * @param cb the callback function (NULL to stop the receiving on this link)
+ */
+void frame_set_cb(serial_t id, void (*cb)(serial_t id, uint8_t * data, uint16_t len))
+{
+    if(id >= HW_SERIAL_NUM) return;
+
+    m_dsc[id].cb = cb;
+    m_dsc[id].idx = 0;
+    m_dsc[id].ovf = false;
+}
+
+/**
+ * Send a frame. The encoded bytes are pushed directly into the tx buffer of the serial module
+ * (Blocking: wait until every byte is buffered)
+ * @param id the id of an SERIAL module
+ * @param data pointer to the payload
+ * @param len length of the payload in bytes (max. FRAME_PAYLOAD_MAX)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t frame_send(serial_t id, const void * data, uint16_t len)
+{
+    if(id >= HW_SERIAL_NUM) return HW_RES_NOT_EX;
+    if(len > FRAME_PAYLOAD_MAX) return HW_RES_INV_PARAM;
+
+    const uint8_t * d8 = data;
+    uint16_t crc16 = frame_crc16(FRAME_CRC_INIT, data, len);
+    uint8_t crc[FRAME_CRC_SIZE] = {crc16 >> 8, crc16 & 0xFF};
+    uint16_t total = len + FRAME_CRC_SIZE;
+    uint16_t i = 0;
+    uint16_t run;
+    hw_res_t res = HW_RES_OK;
+
+    while(res == HW_RES_OK) {
+        /*Count the non-zero bytes until the next zero (or block limit)*/
+        run = 0;
+        while(i + run < total && run < FRAME_COBS_BLOCK_MAX &&
+              frame_get_byte(d8, len, crc, i + run) != 0) {
+            run++;
+        }
+
+        res = frame_put(id, run + 1);
+        if(res == HW_RES_OK) {
+            res = frame_put_array(id, d8, len, crc, i, run);
+        }
+        i += run;
+
+        /*A full block has no implicit zero after it*/
+        if(run == FRAME_COBS_BLOCK_MAX) {
+            if(i >= total) break;
+            else continue;
+        }
+
+        if(i >= total) break;
+        i++;    /*Skip the zero. It is coded by the next block's code*/
+    }
+
+    if(res == HW_RES_OK) {
+        res = frame_put(id, FRAME_DELIMITER);
+    }
+
+    return res;
+}
+
+/**
+ * Process the received bytes on every link which has a callback.
+ * Call it periodically (e.g. from the main loop)
+ */
+void frame_handler(void)
+{
+    serial_t id;
+    for(id = HW_SERIAL1; id < HW_SERIAL_NUM; id++) {
+        if(m_dsc[id].cb != NULL) {
+            frame_rec(id);
+        }
+    }
+}
+
+/**
+ * Read the available bytes of a serial module and decode the completed frames.
+ * The frames are collected and decoded in place in the link's buffer
+ * @param id the id of an SERIAL module
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t frame_rec(serial_t id)
+{
+    if(id >= HW_SERIAL_NUM) return HW_RES_NOT_EX;
+
+    m_dsc_t * dsc = &m_dsc[id];
+    uint8_t byte;
+    uint32_t len = 1;
+    hw_res_t res = HW_RES_OK;
+
+    while(1) {
+        len = 1;
+        res = serial_rec(id, &byte, &len);
+        if(res != HW_RES_OK || len == 0) break;
+
+        if(byte == FRAME_DELIMITER) {
+            if(dsc->ovf != false) dsc->stat.ovf_err++;
+            else if(dsc->idx != 0) frame_process(id);
+
+            dsc->idx = 0;
+            dsc->ovf = false;
+        } else if(dsc->idx < FRAME_BUF_SIZE) {
+            dsc->buf[dsc->idx] = byte;
+            dsc->idx++;
+        } else {
+            dsc->ovf = true;    /*Drop the rest until the next delimiter*/
+        }
+    }
+
+    return res;
+}
+
+/**
+ * Get the receive statistics of a link
+ * @param id the id of an SERIAL module
+ * @param stat the statistics will be copied here
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t frame_get_stat(serial_t id, frame_stat_t * stat)
+{
+    if(id >= HW_SERIAL_NUM) return HW_RES_NOT_EX;
+
+    *stat = m_dsc[id].stat;
+
+    return HW_RES_OK;
+}
+
+/**
+ * Calculate CRC-16 (CCITT: 0x1021 polynomial) with a table driven method
+ * @param crc the initial value (FRAME_CRC_INIT) or the result of a previous call
+ * @param data pointer to the data
+ * @param len length of the data in bytes
+ * @return the new CRC value
+ */
+uint16_t frame_crc16(uint16_t crc, const void * data, uint32_t len)
+{
+    const uint8_t * d8 = data;
+
+    while(len > 0) {
+        crc = (crc << 8) ^ crc16_tbl[((crc >> 8) ^ *d8) & 0xFF];
+        d8++;
+        len--;
+    }
+
+    return crc;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Get a byte from the payload + CRC sequence without copying them together
+ * @param data pointer to the payload
+ * @param len length of the payload
+ * @param crc pointer to the CRC bytes
+ * @param i index of the byte
+ * @return the byte on the given index
+ */
+static uint8_t frame_get_byte(const uint8_t * data, uint16_t len, const uint8_t * crc, uint16_t i)
+{
+    if(i < len) return data[i];
+    else return crc[i - len];
+}
+
+/**
+ * Push a byte into the tx buffer of a serial module. Wait if the buffer is full.
+ * @param id the id of an SERIAL module
+ * @param byte the byte to send
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t frame_put(serial_t id, uint8_t byte)
+{
+    return serial_send_force(id, &byte, 1, SERIAL_TOUT_INF);
+}
+
+/**
+ * Push a part of the payload + CRC sequence into the tx buffer
+ * @param id the id of an SERIAL module
+ * @param data pointer to the payload
+ * @param len length of the payload
+ * @param crc pointer to the CRC bytes
+ * @param start index of the first byte to send
+ * @param num number of bytes to send
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t frame_put_array(serial_t id, const uint8_t * data, uint16_t len,
+                                const uint8_t * crc, uint16_t start, uint16_t num)
+{
+    hw_res_t res = HW_RES_OK;
+
+    /*Send the payload part in one step*/
+    if(start < len) {
+        uint16_t data_num = len - start;
+        if(data_num > num) data_num = num;
+
+        res = serial_send_force(id, &data[start], data_num, SERIAL_TOUT_INF);
+        start += data_num;
+        num -= data_num;
+    }
+
+    /*Send the CRC part*/
+    if(res == HW_RES_OK && num > 0) {
+        res = serial_send_force(id, &crc[start - len], num, SERIAL_TOUT_INF);
+    }
+
+    return res;
+}
+
+/**
+ * Decode a COBS encoded buffer in place (the delimiter is not included)
+ * @param buf pointer to the encoded data. The decoded data will be stored here too.
+ * @param len length of the encoded data
+ * @return length of the decoded data or -1 on encoding error
+ */
+static int32_t frame_cobs_decode(uint8_t * buf, uint16_t len)
+{
+    uint16_t rd = 0;
+    uint16_t wr = 0;
+    uint8_t code;
+    uint8_t i;
+
+    while(rd < len) {
+        code = buf[rd];
+        rd++;
+        if(code == 0) return -1;
+
+        for(i = 1; i < code; i++) {
+            if(rd >= len) return -1;
+            buf[wr] = buf[rd];
+            wr++;
+            rd++;
+        }
+
+        /*Not full blocks are followed by a zero except the last block*/
+        if(code != FRAME_COBS_BLOCK_MAX + 1 && rd < len) {
+            buf[wr] = 0;
+            wr++;
+        }
+    }
+
+    return wr;
+}
+
+/**
+ * Decode and check the collected frame of a link and call the callback with the payload
+ * @param id the id of an SERIAL module
+ */
+static void frame_process(serial_t id)
+{
+    m_dsc_t * dsc = &m_dsc[id];
+    int32_t len = frame_cobs_decode(dsc->buf, dsc->idx);
+
+    if(len < FRAME_CRC_SIZE) {
+        dsc->stat.cobs_err++;
+        return;
+    }
+
+    /*CRC of the payload + the big endian CRC is 0 if there is no error*/
+    if(frame_crc16(FRAME_CRC_INIT, dsc->buf, len) != 0) {
+        dsc->stat.crc_err++;
+        return;
+    }
+
+    dsc->stat.rec++;
+    if(dsc->cb != NULL) dsc->cb(id, dsc->buf, len - FRAME_CRC_SIZE);
+}
+
+#endif
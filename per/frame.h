@@ -0,0 +1,58 @@
+/**
+ * @file frame.h
+ *
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "hw_conf.h"
+#if USE_FRAME != 0 && USE_SERIAL != 0
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hw/hw.h"
+#include "serial.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define FRAME_DELIMITER     0x00
+#define FRAME_CRC_INIT      0xFFFF
+#define FRAME_CRC_SIZE      2
+
+/*Max. payload which fits into an FRAME_BUF_SIZE long encoded frame*/
+#define FRAME_PAYLOAD_MAX   (FRAME_BUF_SIZE - FRAME_CRC_SIZE - 1 - ((FRAME_BUF_SIZE - 1) / 255))
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+    uint32_t rec;       /*Number of valid received frames*/
+    uint32_t crc_err;   /*Frames dropped because of CRC error*/
+    uint32_t cobs_err;  /*Frames dropped because of invalid encoding*/
+    uint32_t ovf_err;   /*Frames dropped because they were longer then FRAME_BUF_SIZE*/
+}frame_stat_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+void frame_init(void);
+void frame_set_cb(serial_t id, void (*cb)(serial_t id, uint8_t * data, uint16_t len));
+hw_res_t frame_send(serial_t id, const void * data, uint16_t len);
+void frame_handler(void);
+hw_res_t frame_rec(serial_t id);
+hw_res_t frame_get_stat(serial_t id, frame_stat_t * stat);
+uint16_t frame_crc16(uint16_t crc, const void * data, uint32_t len);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif
+
+#endif
@@ -9,23 +9,118 @@
 #include "hw_conf.h"
 #if USE_I2C != 0
 
+#include <stddef.h>
+#include <string.h>
+#include "i2c.h"
 #include "psp/psp_i2c.h"
+#include "tick.h"
 
 /*********************
  *      DEFINES
  *********************/
+#if USE_IO == 0 && I2C1_SW != 0
+#error "I2C1_SW requires USE_IO"
+#endif
+#if USE_IO == 0 && I2C2_SW != 0
+#error "I2C2_SW requires USE_IO"
+#endif
+
+/*The bit-banged bus and the bus recovery are compiled only if a bus has pins*/
+#if USE_IO != 0 && (I2C1_SW != 0 || defined(I2C1_SCL_PORT) || I2C2_SW != 0 || defined(I2C2_SCL_PORT))
+#define I2C_SW_USE      1
+#else
+#define I2C_SW_USE      0
+#endif
+
+#if I2C_SW_USE != 0
+#include "io.h"
+
+#ifndef I2C1_SCL_PORT
+#define I2C1_SCL_PORT   IO_PORTX
+#define I2C1_SCL_PIN    IO_PINX
+#define I2C1_SDA_PORT   IO_PORTX
+#define I2C1_SDA_PIN    IO_PINX
+#endif
+#ifndef I2C2_SCL_PORT
+#define I2C2_SCL_PORT   IO_PORTX
+#define I2C2_SCL_PIN    IO_PINX
+#define I2C2_SDA_PORT   IO_PORTX
+#define I2C2_SDA_PIN    IO_PINX
+#endif
+#endif
+
+#define I2CSW_LOOP_DEF  10      /*Delay loops per half clock if they can not be calibrated*/
+#define I2C_RECOVER_TOUT 10     /*Max. clock stretching during the bus recovery [ms]*/
+
+#ifndef I2C_ERR_MAX
+#define I2C_ERR_MAX     3       /*Suspend a bus after this many failed transfers in a row (0: never)*/
+#endif
+#ifndef I2C_ERR_BACKOFF
+#define I2C_ERR_BACKOFF 100     /*Time to suspend a failing bus [ms]*/
+#endif
 
 /**********************
  *      TYPEDEFS
  **********************/
+#if I2C_SW_USE != 0
+/*Bit-banged (software) bus*/
+typedef struct
+{
+    io_port_t scl_port;
+    io_pin_t scl_pin;
+    io_port_t sda_port;
+    io_pin_t sda_pin;
+    uint32_t baud;
+    bool en;
+    uint32_t half_loops;    /*Delay loops for half clock period*/
+    uint32_t tout_start;
+    uint32_t tout;
+}i2csw_dsc_t;
+#endif
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static hw_res_t i2c_xfer_exec(i2c_t id, i2c_msg_t * msgs, uint16_t num);
+static void i2c_err_han(i2c_t id, hw_res_t res);
+static hw_res_t i2c_send_adr(i2c_t id, uint16_t adr, uint16_t flags);
+static void i2c_get_reg(uint16_t reg, uint8_t reg_size, uint8_t * buf);
+static void i2c_bus_set_tout(i2c_t id, uint32_t tout);
+static hw_res_t i2c_bus_start(i2c_t id);
+static hw_res_t i2c_bus_restart(i2c_t id);
+static hw_res_t i2c_bus_stop(i2c_t id);
+static hw_res_t i2c_bus_wr(i2c_t id, uint8_t data);
+static hw_res_t i2c_bus_rd(i2c_t id, uint8_t * data, bool ack);
+#if I2C_SW_USE != 0
+static hw_res_t i2c_recover(i2c_t id);
+static void i2csw_init(void);
+static hw_res_t i2csw_start(i2c_t id);
+static hw_res_t i2csw_restart(i2c_t id);
+static hw_res_t i2csw_stop(i2c_t id);
+static hw_res_t i2csw_wr(i2c_t id, uint8_t data);
+static hw_res_t i2csw_rd(i2c_t id, uint8_t * data, bool ack);
+static hw_res_t i2csw_scl_rel(i2c_t id);
+static void i2csw_delay(i2c_t id);
+#endif
 
 /**********************
  *  STATIC VARIABLES
  **********************/
+static bool held[HW_I2C_NUM];   /*The last transfer ended without stop condition*/
+static i2c_stat_t stat[HW_I2C_NUM];
+#if I2C_ERR_MAX != 0 && USE_TICK != 0
+static uint8_t err_cnt[HW_I2C_NUM];     /*Failed transfers in a row*/
+static uint32_t susp_start[HW_I2C_NUM]; /*Time stamp of the suspend (if err_cnt >= I2C_ERR_MAX)*/
+#endif
+
+#if I2C_SW_USE != 0
+static i2csw_dsc_t sw_dsc[HW_I2C_NUM] = 
+{
+    /*SCL port      SCL pin        SDA port       SDA pin        baud       en*/
+    {I2C1_SCL_PORT, I2C1_SCL_PIN, I2C1_SDA_PORT, I2C1_SDA_PIN, I2C1_BAUD, I2C1_SW},
+    {I2C2_SCL_PORT, I2C2_SCL_PIN, I2C2_SDA_PORT, I2C2_SDA_PIN, I2C2_BAUD, I2C2_SW},
+};
+#endif
 
 /**********************
  *      MACROS
@@ -41,101 +136,675 @@
 void i2c_init(void)
 {
     psp_i2c_init();
+#if I2C_SW_USE != 0
+    i2csw_init();
+#endif
 }
 /**
- * 
- * @param adr
- * @param data_p
- * @param len
- * @return 
+ * Send data to a slave
+ * @param id id of an i2c (from i2c_t)
+ * @param adr 7 bit address of the slave
+ * @param data_p pointer to the data to send
+ * @param len number of bytes to send
+ * @param tout max. time of the whole transfer in milliseconds (I2C_TOUT_INF: no timeout)
+ * @return HW_RES_OK or any error from hw_res_t (HW_RES_TOUT on timeout)
  */
-hw_res_t i2c_send(i2c_t id, uint8_t adr, void * data_p, uint16_t len)
+hw_res_t i2c_send(i2c_t id, uint8_t adr, void * data_p, uint16_t len, uint32_t tout)
 {
-    hw_res_t res = HW_RES_OK;
+    i2c_msg_t msg = {adr, 0, len, data_p};
     
-    res = psp_i2c_start(id);
+    return i2c_xfer(id, &msg, 1, tout);
+}
+
+/**
+ * Send a command to a slave and read its answer
+ * @param id id of an i2c (from i2c_t)
+ * @param adr 7 bit address of the slave
+ * @param cmd command (or register address) to send before the reading
+ * @param data_p the read bytes will be stored here
+ * @param len number of bytes to read
+ * @param tout max. time of the whole transfer in milliseconds (I2C_TOUT_INF: no timeout)
+ * @return HW_RES_OK or any error from hw_res_t (HW_RES_TOUT on timeout)
+ */
+hw_res_t i2c_read(i2c_t id, uint8_t adr, uint8_t cmd, void * data_p, uint16_t len, uint32_t tout)
+{
+    i2c_msg_t msgs[2] = 
+    {
+        {adr, 0,          1,   &cmd},
+        {adr, I2C_MSG_RD, len, data_p},
+    };
     
-    if(res == HW_RES_OK) {
-        res = psp_i2c_wr(id, (adr << 1) & 0xFE);
+    return i2c_xfer(id, msgs, 2, tout);
+}
+
+/**
+ * Execute a combined transfer in one bus transaction. 
+ * The messages are separated by repeated starts (unless I2C_MSG_NO_START) 
+ * and a stop condition is sent after the last one (unless I2C_MSG_NO_STOP). 
+ * @param id id of an i2c (from i2c_t)
+ * @param msgs array of messages
+ * @param num number of messages in 'msgs'
+ * @param tout max. time of the whole transfer in milliseconds (I2C_TOUT_INF: no timeout)
+ * @return HW_RES_OK or any error from hw_res_t (HW_RES_TOUT on timeout)
+ */
+hw_res_t i2c_xfer(i2c_t id, i2c_msg_t * msgs, uint16_t num, uint32_t tout)
+{
+    hw_res_t res;
+    
+    if(id >= HW_I2C_NUM) return HW_RES_NOT_EX;
+    if(msgs == NULL || num == 0) return HW_RES_INV_PARAM;
+    
+#if I2C_ERR_MAX != 0 && USE_TICK != 0
+    /*Do not waste time on a failing bus*/
+    if(err_cnt[id] >= I2C_ERR_MAX) {
+        if(tick_elaps(susp_start[id]) < I2C_ERR_BACKOFF) {
+            stat[id].skip++;
+            return HW_RES_NOT_RDY;
+        }
+        err_cnt[id] = I2C_ERR_MAX - 1;     /*Give one more chance*/
     }
+#endif
+    
+    i2c_bus_set_tout(id, tout);
+    res = i2c_xfer_exec(id, msgs, num);
+    
+    stat[id].xfer++;
+    if(res != HW_RES_OK) i2c_err_han(id, res);
+#if I2C_ERR_MAX != 0 && USE_TICK != 0
+    else err_cnt[id] = 0;
+#endif
+    
+    return res;
+}
+
+/**
+ * Get the statistics of a bus
+ * @param id id of an i2c (from i2c_t)
+ * @param st the statistics will be copied here
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t i2c_get_stat(i2c_t id, i2c_stat_t * st)
+{
+    if(id >= HW_I2C_NUM) return HW_RES_NOT_EX;
+    
+    *st = stat[id];
     
-    if(res == HW_RES_OK) {
-        uint8_t * d8_p = data_p;  /*Easy to use uint8_t pointer to the data*/
-        for(; len > 0; len--) {
+    return HW_RES_OK;
+}
 
-            res = psp_i2c_wr(id, *d8_p);
-            if(res != HW_RES_OK) {
-                break;
+/**
+ * Clear the statistics of a bus
+ * @param id id of an i2c (from i2c_t)
+ */
+void i2c_clr_stat(i2c_t id)
+{
+    if(id >= HW_I2C_NUM) return;
+    
+    memset(&stat[id], 0, sizeof(i2c_stat_t));
+}
+
+/**
+ * Read registers of a slave with 8 or 16 bit register address (MSB first)
+ * @param id id of an i2c (from i2c_t)
+ * @param adr 7 bit address of the slave (or 10 bit with I2C_ADR_TEN)
+ * @param reg address of the first register
+ * @param reg_size size of the register address in bytes (1 or 2)
+ * @param data_p the read bytes will be stored here
+ * @param len number of bytes to read
+ * @param tout max. time of the whole transfer in milliseconds (I2C_TOUT_INF: no timeout)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t i2c_read_reg(i2c_t id, uint16_t adr, uint16_t reg, uint8_t reg_size, void * data_p, uint16_t len, uint32_t tout)
+{
+    uint8_t reg_buf[2];
+    uint16_t flags = 0;
+    
+    if(reg_size != 1 && reg_size != 2) return HW_RES_INV_PARAM;
+    i2c_get_reg(reg, reg_size, reg_buf);
+    if(adr & I2C_ADR_TEN) flags = I2C_MSG_TEN;
+    
+    i2c_msg_t msgs[2] = 
+    {
+        {adr & ~I2C_ADR_TEN, flags,              reg_size, reg_buf},
+        {adr & ~I2C_ADR_TEN, flags | I2C_MSG_RD, len,      data_p},
+    };
+    
+    return i2c_xfer(id, msgs, 2, tout);
+}
+
+/**
+ * Write registers of a slave with 8 or 16 bit register address (MSB first).
+ * The address and the data are sent without copying them into one buffer.
+ * @param id id of an i2c (from i2c_t)
+ * @param adr 7 bit address of the slave (or 10 bit with I2C_ADR_TEN)
+ * @param reg address of the first register
+ * @param reg_size size of the register address in bytes (1 or 2)
+ * @param data_p pointer to the data to write
+ * @param len number of bytes to write
+ * @param tout max. time of the whole transfer in milliseconds (I2C_TOUT_INF: no timeout)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t i2c_write_reg(i2c_t id, uint16_t adr, uint16_t reg, uint8_t reg_size, const void * data_p, uint16_t len, uint32_t tout)
+{
+    uint8_t reg_buf[2];
+    uint16_t flags = 0;
+    
+    if(reg_size != 1 && reg_size != 2) return HW_RES_INV_PARAM;
+    i2c_get_reg(reg, reg_size, reg_buf);
+    if(adr & I2C_ADR_TEN) flags = I2C_MSG_TEN;
+    
+    i2c_msg_t msgs[2] = 
+    {
+        {adr & ~I2C_ADR_TEN, flags,                    reg_size, reg_buf},
+        {adr & ~I2C_ADR_TEN, flags | I2C_MSG_NO_START, len,      (uint8_t *) data_p},
+    };
+    
+    return i2c_xfer(id, msgs, 2, tout);
+}
+
+/**
+ * A blocking transfer waits (within its timeout) for the running transaction and the other queued ones wait for the blocking transfer.
+ * A blocking transfer waits for the running transaction (within its timeout) and the queue waits for it.
+ * @param id id of an i2c (from i2c_t)
+ * @param trans pointer to a transaction descriptor. Has to be valid until its callback is called.
+ * @return HW_RES_OK: queued, or any error from hw_res_t (the callback won't be called)
+ */
+hw_res_t i2c_xfer_async(i2c_t id, i2c_trans_t * trans)
+{
+    if(id >= HW_I2C_NUM) return HW_RES_NOT_EX;
+    if(trans == NULL) return HW_RES_INV_PARAM;
+    if(trans->wr_len == 0 && trans->rd_len == 0) return HW_RES_INV_PARAM;
+    if(trans->wr_len != 0 && trans->wr_data == NULL) return HW_RES_INV_PARAM;
+    if(trans->rd_len != 0 && trans->rd_data == NULL) return HW_RES_INV_PARAM;
+    
+    return psp_i2c_xfer_async(id, trans);
+}
+
+/**
+ * Check if there are queued or running asynchronous transactions
+ * @param id id of an i2c (from i2c_t)
+ * @return true: busy, false: the queue is empty
+ */
+bool i2c_busy(i2c_t id)
+{
+    if(id >= HW_I2C_NUM) return false;
+    
+    return psp_i2c_busy(id);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Execute the messages of 'i2c_xfer'
+ * @param id id of an i2c (from i2c_t)
+ * @param msgs array of messages
+ * @param num number of messages in 'msgs'
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t i2c_xfer_exec(i2c_t id, i2c_msg_t * msgs, uint16_t num)
+{
+    hw_res_t res = HW_RES_OK;
+    uint16_t i;
+    uint16_t j;
+    
+    for(i = 0; i < num && res == HW_RES_OK; i++) {
+        i2c_msg_t * m = &msgs[i];
+        
+        /*(Re)start and address the slave*/
+        if(i == 0 || (m->flags & I2C_MSG_NO_START) == 0) {
+            if(i == 0 && held[id] == false) res = i2c_bus_start(id);
+            else res = i2c_bus_restart(id);
+            
+            if(res == HW_RES_OK) res = i2c_send_adr(id, m->adr, m->flags);
+        }
+        
+        /*Transfer the data. NACK only the last byte of a read*/
+        for(j = 0; j < m->len && res == HW_RES_OK; j++) {
+            if(m->flags & I2C_MSG_RD) {
+                bool ack = true;
+                if(j + 1 == m->len) {
+                    if(i + 1 == num) ack = false;
+                    else if((msgs[i + 1].flags & I2C_MSG_NO_START) == 0) ack = false;
+                }
+                res = i2c_bus_rd(id, &m->buf[j], ack);
+            } else {
+                res = i2c_bus_wr(id, m->buf[j]);
             }
-            d8_p ++;
         }
     }
-
-    /*Uncoditionally send a stop condition*/
-    psp_i2c_stop(id);
+    
+    /*Keep the bus only on success*/
+    if(res == HW_RES_OK && (msgs[num - 1].flags & I2C_MSG_NO_STOP)) {
+        held[id] = true;
+    } else {
+#if I2C_SW_USE != 0
+        /*A slave can hold SDA low if it was interrupted in the middle of a byte.
+         *Recover before the stop: until then no queued asynchronous transaction can start.
+         *Not if an asynchronous transaction is waiting or running (the start might have timed out waiting for it).
+         *It is aborted after I2C_ASYNC_TOUT and the next transfer can recover the bus.*/
+        if((res == HW_RES_TOUT || res == HW_RES_NOT_RDY) && psp_i2c_busy(id) == false) {
+            if(i2c_recover(id) == HW_RES_OK) stat[id].recover++;
+        }
+#endif
+        i2c_bus_stop(id);
+        held[id] = false;
+    }
     
     return res;
 }
 
 /**
- * 
- * @param adr
- * @param cmd
- * @param data_p
- * @param len
- * @return 
+ * Count an error and suspend the bus after too many of them
+ * @param id id of an i2c (from i2c_t)
+ * @param res the result of the failed transfer
  */
-hw_res_t i2c_read(i2c_t id, uint8_t adr, uint8_t cmd, void * data_p, uint16_t len)
+static void i2c_err_han(i2c_t id, hw_res_t res)
 {
-    hw_res_t res = HW_RES_OK;
-   
-    /*Address the salve for write and send the command*/
-    res = psp_i2c_start(id);
-    
-    if(res == HW_RES_OK) {
-        res = psp_i2c_wr(id, (adr << 1) & 0xFE);   
+    switch(res) {
+        case HW_RES_NO_ACK:
+            stat[id].nack++;
+            break;
+        case HW_RES_TOUT:
+            stat[id].tout++;
+            break;
+        case HW_RES_NOT_RDY:
+            stat[id].busy++;
+            break;
+        default:
+            break;
     }
     
-    if(res == HW_RES_OK) {
-        res = psp_i2c_wr(id, cmd);
+#if I2C_ERR_MAX != 0 && USE_TICK != 0
+    if(err_cnt[id] < I2C_ERR_MAX) err_cnt[id]++;
+    if(err_cnt[id] >= I2C_ERR_MAX) susp_start[id] = tick_get();
+#endif
+}
+
+
+/**
+ * Send the address of the slave after a (re)start
+ * @param id id of an i2c (from i2c_t)
+ * @param adr 7 or 10 bit address
+ * @param flags flags of the message (I2C_MSG_RD and I2C_MSG_TEN is used)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t i2c_send_adr(i2c_t id, uint16_t adr, uint16_t flags)
+{
+    hw_res_t res;
+    
+    if((flags & I2C_MSG_TEN) == 0) {
+        return i2c_bus_wr(id, ((adr << 1) & 0xFE) | (flags & I2C_MSG_RD ? 0x01 : 0x00));
     }
     
-    /*Restart, address for read and begin the reading*/
-    if(res == HW_RES_OK) {
-        res = psp_i2c_restart(id);
+    /*10 bit: 11110xx0 and the lower 8 bits for write. 
+     *To read send 11110xx1 after a repeated start*/
+    uint8_t hdr = 0xF0 | ((adr >> 7) & 0x06);
+    res = i2c_bus_wr(id, hdr);
+    if(res == HW_RES_OK) res = i2c_bus_wr(id, adr & 0xFF);
+    if(res == HW_RES_OK && (flags & I2C_MSG_RD)) {
+        res = i2c_bus_restart(id);
+        if(res == HW_RES_OK) res = i2c_bus_wr(id, hdr | 0x01);
     }
     
-    if(res == HW_RES_OK) {
-        psp_i2c_wr(id, (adr << 1) | 0x01);
+    return res;
+}
+
+/**
+ * Convert a register address to bytes (MSB first)
+ * @param reg the register address
+ * @param reg_size size of the register address in bytes (1 or 2)
+ * @param buf store the bytes here
+ */
+static void i2c_get_reg(uint16_t reg, uint8_t reg_size, uint8_t * buf)
+{
+    if(reg_size == 2) {
+        buf[0] = reg >> 8;
+        buf[1] = reg & 0xFF;
+    } else {
+        buf[0] = reg & 0xFF;
     }
+}
+
+/**
+ * Set the timeout of a transfer on a hardware or software bus
+ * @param id id of an i2c (from i2c_t)
+ * @param tout timeout in milliseconds (I2C_TOUT_INF: no timeout)
+ */
+static void i2c_bus_set_tout(i2c_t id, uint32_t tout)
+{
+#if I2C_SW_USE != 0
+    if(sw_dsc[id].en != false) {
+#if USE_TICK != 0
+        sw_dsc[id].tout_start = tick_get();
+        sw_dsc[id].tout = tout;
+#else
+        sw_dsc[id].tout = I2C_TOUT_INF;
+#endif
+        return;
+    }
+#endif
     
-    /*Ready all bytes exept the last*/
-    if(res == HW_RES_OK) {
-        uint8_t * d8_p = data_p;
-        bool ack;
-        for(; len > 0; len --) {
+    psp_i2c_set_tout(id, tout);
+}
 
-            if(len > 1) {
-                ack = true;
-            } else {
-                ack = false;
-            }
-            res = psp_i2c_rd(id, d8_p, ack);
-            if(res != HW_RES_OK) {
-                break;
-            }
-            d8_p ++;
+/**
+ * Make a start condition on a hardware or software bus
+ * @param id id of an i2c (from i2c_t)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t i2c_bus_start(i2c_t id)
+{
+#if I2C_SW_USE != 0
+    if(sw_dsc[id].en != false) return i2csw_start(id);
+#endif
+    return psp_i2c_start(id);
+}
+
+/**
+ * Make a restart condition on a hardware or software bus
+ * @param id id of an i2c (from i2c_t)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t i2c_bus_restart(i2c_t id)
+{
+#if I2C_SW_USE != 0
+    if(sw_dsc[id].en != false) return i2csw_restart(id);
+#endif
+    return psp_i2c_restart(id);
+}
+
+/**
+ * Make a stop condition on a hardware or software bus
+ * @param id id of an i2c (from i2c_t)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t i2c_bus_stop(i2c_t id)
+{
+#if I2C_SW_USE != 0
+    if(sw_dsc[id].en != false) return i2csw_stop(id);
+#endif
+    return psp_i2c_stop(id);
+}
+
+/**
+ * Write a byte on a hardware or software bus
+ * @param id id of an i2c (from i2c_t)
+ * @param data byte to write
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t i2c_bus_wr(i2c_t id, uint8_t data)
+{
+#if I2C_SW_USE != 0
+    if(sw_dsc[id].en != false) return i2csw_wr(id, data);
+#endif
+    return psp_i2c_wr(id, data);
+}
+
+/**
+ * Read a byte from a hardware or software bus
+ * @param id id of an i2c (from i2c_t)
+ * @param data pointer to a variable to store the read data
+ * @param ack true: send ACK, false: send NACK
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t i2c_bus_rd(i2c_t id, uint8_t * data, bool ack)
+{
+#if I2C_SW_USE != 0
+    if(sw_dsc[id].en != false) return i2csw_rd(id, data, ack);
+#endif
+    return psp_i2c_rd(id, data, ack);
+}
+
+#if I2C_SW_USE != 0
+/*Open-drain outputs: the latch is always 0, only the direction is changed*/
+#define I2CSW_SCL_LOW(id)   io_set_pin_dir(sw_dsc[id].scl_port, sw_dsc[id].scl_pin, IO_DIR_OUT)
+#define I2CSW_SDA_LOW(id)   io_set_pin_dir(sw_dsc[id].sda_port, sw_dsc[id].sda_pin, IO_DIR_OUT)
+#define I2CSW_SDA_REL(id)   io_set_pin_dir(sw_dsc[id].sda_port, sw_dsc[id].sda_pin, IO_DIR_IN)
+#define I2CSW_SDA_GET(id)   io_get_pin(sw_dsc[id].sda_port, sw_dsc[id].sda_pin)
+
+/**
+ * Initialize the pins of the software buses and set their timing
+ */
+static void i2csw_init(void)
+{
+    i2c_t id;
+    
+    for(id = HW_I2C1; id < HW_I2C_NUM; id++) {
+        i2csw_dsc_t * dsc = &sw_dsc[id];
+        
+        /*The pins of a hardware bus are used for the bus recovery*/
+        if(dsc->baud == 0 || dsc->scl_port == IO_PORTX || dsc->sda_port == IO_PORTX) {
+            dsc->en = false;
+            continue;
         }
+        
+        if(dsc->en != false) {
+            io_set_pin(dsc->scl_port, dsc->scl_pin, 0);
+            io_set_pin(dsc->sda_port, dsc->sda_pin, 0);
+            io_set_pin_dir(dsc->scl_port, dsc->scl_pin, IO_DIR_IN);
+            io_set_pin_dir(dsc->sda_port, dsc->sda_pin, IO_DIR_IN);
+        }
+        dsc->tout = I2C_TOUT_INF;
+        dsc->half_loops = I2CSW_LOOP_DEF;
+        
+#if USE_TICK != 0
+        /*The wait loop of the tick is calibrated in 'tick_init'. 
+         *The pin handling adds time so the clock can be only slower than the baud rate.*/
+        dsc->half_loops = ((uint64_t) tick_get_ms_loops() * 500) / dsc->baud;
+#endif
+    }
+}
+
+/**
+ * Make a start condition on a software bus
+ * @param id id of an i2c (from i2c_t)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t i2csw_start(i2c_t id)
+{
+    hw_res_t res;
+    
+    I2CSW_SDA_REL(id);
+    res = i2csw_scl_rel(id);
+    if(res != HW_RES_OK) return res;
+    
+    /*An other master or a stuck slave holds the bus*/
+    if(I2CSW_SDA_GET(id) == 0) return HW_RES_NOT_RDY;
+    
+    i2csw_delay(id);
+    I2CSW_SDA_LOW(id);
+    i2csw_delay(id);
+    I2CSW_SCL_LOW(id);
+    
+    return HW_RES_OK;
+}
+
+/**
+ * Make a repeated start condition on a software bus
+ * @param id id of an i2c (from i2c_t)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t i2csw_restart(i2c_t id)
+{
+    I2CSW_SDA_REL(id);
+    i2csw_delay(id);
+    
+    return i2csw_start(id);
+}
+
+/**
+ * Make a stop condition on a software bus
+ * @param id id of an i2c (from i2c_t)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t i2csw_stop(i2c_t id)
+{
+    hw_res_t res;
+    
+    I2CSW_SDA_LOW(id);
+    i2csw_delay(id);
+    res = i2csw_scl_rel(id);
+    i2csw_delay(id);
+    I2CSW_SDA_REL(id);
+    i2csw_delay(id);
+    
+    return res;
+}
+
+/**
+ * Write a byte on a software bus
+ * @param id id of an i2c (from i2c_t)
+ * @param data byte to write
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t i2csw_wr(i2c_t id, uint8_t data)
+{
+    hw_res_t res;
+    uint8_t mask;
+    
+    for(mask = 0x80; mask != 0; mask = mask >> 1) {
+        if(data & mask) I2CSW_SDA_REL(id);
+        else I2CSW_SDA_LOW(id);
+        
+        i2csw_delay(id);
+        res = i2csw_scl_rel(id);
+        if(res != HW_RES_OK) return res;
+        i2csw_delay(id);
+        I2CSW_SCL_LOW(id);
     }
     
-    /*Uncoditionally send a stop condition*/
-    psp_i2c_stop(id);
+    /*Read the ACK*/
+    I2CSW_SDA_REL(id);
+    i2csw_delay(id);
+    res = i2csw_scl_rel(id);
+    if(res != HW_RES_OK) return res;
+    i2csw_delay(id);
+    if(I2CSW_SDA_GET(id) != 0) res = HW_RES_NO_ACK;
+    I2CSW_SCL_LOW(id);
     
     return res;
 }
 
-/**********************
- *   STATIC FUNCTIONS
- **********************/
+/**
+ * Read a byte from a software bus
+ * @param id id of an i2c (from i2c_t)
+ * @param data pointer to a variable to store the read data
+ * @param ack true: send ACK, false: send NACK
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t i2csw_rd(i2c_t id, uint8_t * data, bool ack)
+{
+    hw_res_t res;
+    uint8_t rec = 0;
+    uint8_t i;
+    
+    I2CSW_SDA_REL(id);
+    for(i = 0; i < 8; i++) {
+        i2csw_delay(id);
+        res = i2csw_scl_rel(id);
+        if(res != HW_RES_OK) return res;
+        i2csw_delay(id);
+        rec = rec << 1;
+        if(I2CSW_SDA_GET(id) != 0) rec |= 0x01;
+        I2CSW_SCL_LOW(id);
+    }
+    *data = rec;
+    
+    /*Send ACK or NACK*/
+    if(ack != false) I2CSW_SDA_LOW(id);
+    i2csw_delay(id);
+    res = i2csw_scl_rel(id);
+    i2csw_delay(id);
+    I2CSW_SCL_LOW(id);
+    I2CSW_SDA_REL(id);
+    
+    return res;
+}
+
+/**
+ * Release SCL and wait while a slave stretches the clock
+ * @param id id of an i2c (from i2c_t)
+ * @return HW_RES_OK or HW_RES_TOUT if the timeout of the transfer is elapsed
+ */
+static hw_res_t i2csw_scl_rel(i2c_t id)
+{
+    i2csw_dsc_t * dsc = &sw_dsc[id];
+    
+    io_set_pin_dir(dsc->scl_port, dsc->scl_pin, IO_DIR_IN);
+    
+    while(io_get_pin(dsc->scl_port, dsc->scl_pin) == 0) {
+#if USE_TICK != 0
+        if(dsc->tout != I2C_TOUT_INF && tick_elaps(dsc->tout_start) >= dsc->tout) {
+            return HW_RES_TOUT;
+        }
+#endif
+    }
+    
+    return HW_RES_OK;
+}
+
+/**
+ * Wait a half clock period of a software bus
+ * @param id id of an i2c (from i2c_t)
+ */
+static void i2csw_delay(i2c_t id)
+{
+#if USE_TICK != 0
+    tick_wait_loops(sw_dsc[id].half_loops);
+#else
+    volatile uint32_t i;
+    for(i = 0; i < sw_dsc[id].half_loops; i++);
+#endif
+}
+
+/**
+ * Free the bus if a slave holds SDA low: clock SCL (max. 9 times) until SDA is released
+ * then make a stop condition. A hardware module is disabled meanwhile.
+ * @param id id of an i2c (from i2c_t)
+ * @return HW_RES_OK: the bus is free, HW_RES_DIS: no pins are configured, 
+ *         HW_RES_NOT_RDY: SDA is still low
+ */
+static hw_res_t i2c_recover(i2c_t id)
+{
+    i2csw_dsc_t * dsc = &sw_dsc[id];
+    uint8_t i;
+    
+    if(dsc->scl_port == IO_PORTX || dsc->sda_port == IO_PORTX) return HW_RES_DIS;
+    
+    if(dsc->en == false) psp_i2c_en(id, false);
+    
+#if USE_TICK != 0
+    dsc->tout_start = tick_get();
+    dsc->tout = I2C_RECOVER_TOUT;
+#endif
+    io_set_pin(dsc->scl_port, dsc->scl_pin, 0);
+    io_set_pin(dsc->sda_port, dsc->sda_pin, 0);
+    I2CSW_SDA_REL(id);
+    
+    for(i = 0; i < 9 && I2CSW_SDA_GET(id) == 0; i++) {
+        I2CSW_SCL_LOW(id);
+        i2csw_delay(id);
+        if(i2csw_scl_rel(id) != HW_RES_OK) break;
+        i2csw_delay(id);
+    }
+    
+    /*Stop condition*/
+    I2CSW_SCL_LOW(id);
+    I2CSW_SDA_LOW(id);
+    i2csw_delay(id);
+    i2csw_scl_rel(id);
+    i2csw_delay(id);
+    I2CSW_SDA_REL(id);
+    i2csw_delay(id);
+    
+    hw_res_t res = I2CSW_SDA_GET(id) != 0 ? HW_RES_OK : HW_RES_NOT_RDY;
+    
+    if(dsc->en == false) psp_i2c_en(id, true);
+    
+    return res;
+}
+#endif
 
 #endif
@@ -18,17 +18,51 @@
 /*********************
  *      DEFINES
  *********************/
+#define I2C_TOUT_INF    UINT32_MAX  /*Wait without timeout*/
+
+/*Flags of 'i2c_msg_t'*/
+#define I2C_MSG_RD          0x0001  /*Read (else write)*/
+#define I2C_MSG_TEN         0x0002  /*10 bit slave address*/
+#define I2C_MSG_NO_START    0x0004  /*Continue the previous message without (re)start and address*/
+#define I2C_MSG_NO_STOP     0x0008  /*Keep the bus after the last message. The next 'i2c_xfer' starts with a restart*/
+
+#define I2C_ADR_TEN         0x8000  /*OR to the address in 'i2c_read/write_reg' to use 10 bit address*/
 
 /**********************
  *      TYPEDEFS
  **********************/
+/*A segment of a combined transfer (similar to Linux's 'i2c_msg')*/
+typedef struct
+{
+    uint16_t adr;       /*7 or 10 bit (I2C_MSG_TEN) slave address*/
+    uint16_t flags;     /*OR-ed I2C_MSG_... flags*/
+    uint16_t len;       /*Number of bytes to read or write*/
+    uint8_t * buf;      /*The data to write or store the read data here*/
+}i2c_msg_t;
+
+typedef struct
+{
+    uint32_t xfer;      /*Number of transfers (also the failed ones)*/
+    uint32_t nack;      /*Not acknowledged*/
+    uint32_t tout;      /*Timeout (e.g. clock stretched too long)*/
+    uint32_t busy;      /*The bus was not free (SDA low or bus collision)*/
+    uint32_t recover;   /*Successful bus recoveries*/
+    uint32_t skip;      /*Transfers refused while the bus is suspended after errors*/
+}i2c_stat_t;
 
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
 void i2c_init(void);
-hw_res_t i2c_send(i2c_t id, uint8_t adr, void * data_p, uint16_t len);
-hw_res_t i2c_read(i2c_t id, uint8_t adr, uint8_t cmd, void * data_p, uint16_t len); 
+hw_res_t i2c_send(i2c_t id, uint8_t adr, void * data_p, uint16_t len, uint32_t tout);
+hw_res_t i2c_read(i2c_t id, uint8_t adr, uint8_t cmd, void * data_p, uint16_t len, uint32_t tout);
+hw_res_t i2c_xfer(i2c_t id, i2c_msg_t * msgs, uint16_t num, uint32_t tout);
+hw_res_t i2c_get_stat(i2c_t id, i2c_stat_t * st);
+void i2c_clr_stat(i2c_t id);
+hw_res_t i2c_read_reg(i2c_t id, uint16_t adr, uint16_t reg, uint8_t reg_size, void * data_p, uint16_t len, uint32_t tout);
+hw_res_t i2c_write_reg(i2c_t id, uint16_t adr, uint16_t reg, uint8_t reg_size, const void * data_p, uint16_t len, uint32_t tout);
+hw_res_t i2c_xfer_async(i2c_t id, i2c_trans_t * trans);
+bool i2c_busy(i2c_t id);
 
 /**********************
  *      MACROS
@@ -9,6 +9,7 @@
 #include "hw_conf.h"
 #if USE_PARALLEL != 0
 
+#include <stddef.h>
 #include "psp/psp_par.h"
 #include "par.h"
 #include "io.h"
@@ -22,21 +23,70 @@
 #define REPEATE8(cmd) {cmd; cmd; cmd; cmd; cmd; cmd; cmd; cmd;}
 #define BATCH_COM      64
 
+#if PAR_MODE == PAR_MODE_6800
+#define PARSW_STB_ACT   1               /*E (on the WR pin) is active high*/
+#define PARSW_RD_IDLE   0               /*R/W (on the RD pin) is low: write*/
+#define PARSW_RDS_PORT  PARSW_WR_PORT   /*Read strobe: E*/
+#define PARSW_RDS_PIN   PARSW_WR_PIN
+#else
+#define PARSW_STB_ACT   0               /*WR and RD are active low*/
+#define PARSW_RD_IDLE   1
+#define PARSW_RDS_PORT  PARSW_RD_PORT   /*Read strobe: RD*/
+#define PARSW_RDS_PIN   PARSW_RD_PIN
+#endif
+
 #ifndef PARSW_WR_STROBE
-#define PARSW_WR_STROBE() par_sw_wr_strobe();
+#define PARSW_WR_STROBE_FUNC
+#define PARSW_WR_STROBE par_sw_wr_strobe()
 #endif
 
 
 #ifndef PARSW_WR_DATA
 #define PARSW_WR_DATA(data_p) {io_set_port(PARSW_DATA_PORT, *data_p); \
                                data_p++; \
-                               par_sw_wr_strobe();}
+                               PARSW_WR_STROBE;}
+#endif
+
+#ifndef PARSW_RD_STROBE
+#define PARSW_RD_STROBE io_set_pin(PARSW_RDS_PORT, PARSW_RDS_PIN, PARSW_STB_ACT)
 #endif
 
+#ifndef PARSW_RD_DATA
+#define PARSW_RD_DATA(data_p) {PARSW_RD_STROBE; \
+                               *data_p = io_get_port(PARSW_DATA_PORT); \
+                               io_set_pin(PARSW_RDS_PORT, PARSW_RDS_PIN, !PARSW_STB_ACT); \
+                               data_p++;}
+#endif
+
+#define PARSW_SLOW_RD_DATA(data_p) {io_set_pin(PARSW_RDS_PORT, PARSW_RDS_PIN, PARSW_STB_ACT); \
+                                    tick_wait_us(1); \
+                                    *data_p = io_get_port(PARSW_DATA_PORT); \
+                                    io_set_pin(PARSW_RDS_PORT, PARSW_RDS_PIN, !PARSW_STB_ACT); \
+                                    tick_wait_us(1); \
+                                    data_p++;}
+
 #define PARSW_SLOW_WR_DATA(data_p) {io_set_port(PARSW_DATA_PORT, *data_p); \
                                     data_p++; \
                                     par_sw_slow_wr_strobe();}
 
+/*Write a 16 bit word (on 8 bit bus in two cycles, MSB first)*/
+#if PAR_WIDTH == 8
+#define PARSW_WR_WORD(data_p) {io_set_port(PARSW_DATA_PORT, *data_p >> 8); \
+                               PARSW_WR_STROBE; \
+                               io_set_port(PARSW_DATA_PORT, *data_p & 0xFF); \
+                               PARSW_WR_STROBE; \
+                               data_p++;}
+
+#define PARSW_SLOW_WR_WORD(data_p) {io_set_port(PARSW_DATA_PORT, *data_p >> 8); \
+                                    par_sw_slow_wr_strobe(); \
+                                    io_set_port(PARSW_DATA_PORT, *data_p & 0xFF); \
+                                    par_sw_slow_wr_strobe(); \
+                                    data_p++;}
+#else
+#define PARSW_WR_WORD(data_p)       PARSW_WR_DATA(data_p)
+#define PARSW_SLOW_WR_WORD(data_p)  PARSW_SLOW_WR_DATA(data_p)
+#endif
+
 #endif
 /**********************
  *      TYPEDEFS
@@ -48,8 +98,18 @@
 #if PAR_SW != 0
 static void par_sw_wr_array(uint32_t adr, const uint16_t * data_p, uint32_t length);
 static void par_sw_fill(uint32_t adr, uint16_t data, uint32_t length);
+static void par_sw_rd_array(uint32_t adr, uint16_t * data_p, uint32_t length);
+static void par_sw_wr(uint32_t adr, uint16_t data);
+static uint16_t par_sw_rd(uint32_t adr);
+static uint16_t par_sw_rd_cycle(void);
+static void par_sw_rd_begin(void);
+static void par_sw_rd_end(void);
+#if PAR_WIDTH == 8
+static void par_sw_fill8(uint16_t data, uint32_t length);
+#endif
 static void par_sw_slow_wr_strobe(void);
-#ifndef PARSW_WR_STROBE  
+static inline void par_sw_set_adr(uint32_t adr);
+#ifdef PARSW_WR_STROBE_FUNC
 static void par_sw_wr_strobe(void);
 #endif
 #endif
@@ -58,6 +118,10 @@ static void par_sw_wr_strobe(void);
  *  STATIC VARIABLES
  **********************/
 static uint8_t slow_mode = 0;
+static uint32_t act_adr = 0;
+#if PAR_SW != 0
+static uint32_t sw_adr = 0;     /*Last value of PARSW_ADR_PORT*/
+#endif
 
 /**********************
  *      MACROS
@@ -83,9 +147,9 @@ void par_init(void)
     
 #if PAR_SW != 0
     io_set_pin_dir(PARSW_RD_PORT, PARSW_RD_PIN, IO_DIR_OUT);
-    io_set_pin(PARSW_RD_PORT, PARSW_RD_PIN, 1);
+    io_set_pin(PARSW_RD_PORT, PARSW_RD_PIN, PARSW_RD_IDLE);
     io_set_pin_dir(PARSW_WR_PORT, PARSW_WR_PIN, IO_DIR_OUT);
-    io_set_pin(PARSW_WR_PORT, PARSW_WR_PIN, 1);
+    io_set_pin(PARSW_WR_PORT, PARSW_WR_PIN, !PARSW_STB_ACT);
     
     io_set_port_dir(PARSW_ADR_PORT, IO_DIR_OUT);
     io_set_port(PARSW_ADR_PORT, 0);
@@ -106,12 +170,27 @@ void par_set_wait_time(uint8_t wait)
     psp_par_set_wait_time(wait);
 }
 
+/**
+ * Set the address of the next reads and writes. E.g. an address line can drive
+ * the RS pin of a display controller to select command or data.
+ * The address lines are changed only when the next read or write starts
+ * (so after the running asynchronous write).
+ * @param adr the new address
+ */
+void par_set_adr(uint32_t adr)
+{
+    act_adr = adr;
+}
+
 /**
  * Pull down a Chip Select
  * @param cs a Chip Select from par_cs_t
  */
 void par_cs_en(par_cs_t cs)
 {
+    /*Don't switch the device during an asynchronous write*/
+    while(par_busy() != false);
+
     switch(cs)
     {
         case PAR_CS1:
@@ -133,6 +212,9 @@ void par_cs_en(par_cs_t cs)
  */
 void par_cs_dis(par_cs_t cs)
 {   
+    /*Don't switch the device during an asynchronous write*/
+    while(par_busy() != false);
+
     switch(cs)
     {
         case PAR_CS1:
@@ -148,47 +230,108 @@ void par_cs_dis(par_cs_t cs)
 }
 
 /**
- * Write 1 word to the parallel port
+ * Write 1 bus word (8 or 16 bit, e.g. a command) to the parallel port
  * @param data the word to write 
  */
 void par_wr(uint16_t data)
 {
 
 #if PAR_SW != 0
-    par_sw_wr_array(0, &data, 1);
+    par_sw_wr(act_adr, data);
 #else
-    psp_par_wr_array(0, &data, 1);
+    psp_par_wr(act_adr, data);
 #endif
 }
 
 /**
- * Write an array to the parallel port
+ * Write an array to the parallel port.
+ * With 8 bit bus (PAR_WIDTH) every word (e.g. an RGB565 pixel) is sent in two cycles (MSB first).
  * @param data_p pointer to the data to write
  * @param size number of element in the array 
  */
 void par_wr_array(uint16_t * data_p, uint32_t size)
 {
 #if PAR_SW != 0
-    par_sw_wr_array(0, data_p, size);
+    par_sw_wr_array(act_adr, data_p, size);
+#else
+    psp_par_wr_array(act_adr, data_p, size);
+#endif
+}
+
+/**
+ * Read 1 bus word (8 or 16 bit) from the parallel port
+ * @return the read word
+ */
+uint16_t par_rd(void)
+{
+#if PAR_SW != 0
+    return par_sw_rd(act_adr);
+#else
+    return psp_par_rd(act_adr);
+#endif
+}
+
+/**
+ * Read an array from the parallel port.
+ * With 8 bit bus every word is read in two cycles (MSB first).
+ * @param data_p pointer to a buffer to store the read words
+ * @param size number of words to read
+ */
+void par_rd_array(uint16_t * data_p, uint32_t size)
+{
+#if PAR_SW != 0
+    par_sw_rd_array(act_adr, data_p, size);
+#else
+    psp_par_rd_array(act_adr, data_p, size);
+#endif
+}
+
+/**
+ * Write an array to the parallel port in the background (with DMA if enabled).
+ * Without DMA (or with PAR_SW) the array is written here and 'cb' is called before return.
+ * The other write functions wait until the asynchronous write is ready.
+ * @param data_p pointer to the data to write. Has to be valid until 'cb' is called.
+ * @param size number of element in the array
+ * @param cb called when all the data is written, maybe from interrupt (can be NULL)
+ */
+void par_wr_array_async(const uint16_t * data_p, uint32_t size, par_cb_t cb)
+{
+#if PAR_SW != 0
+    par_sw_wr_array(act_adr, data_p, size);
+#else
+    if(psp_par_wr_array_async(act_adr, data_p, size, cb) == HW_RES_OK) return;
+    psp_par_wr_array(act_adr, data_p, size);
+#endif
+
+    if(cb != NULL) cb();
+}
+
+/**
+ * Check the parallel port. Wait for it before changing control signals
+ * (e.g. a display's RS pin) after 'par_wr_array_async'
+ * @return true: an asynchronous write is in progress
+ */
+bool par_busy(void)
+{
+#if PAR_SW != 0
+    return false;
 #else
-    psp_par_wr_array(0, data_p, size);
+    return psp_par_busy();
 #endif
 }
 
 /**
- * Write a word to the parallel port multiply times
+ * Write a word to the parallel port multiply times.
+ * With 8 bit bus every word is sent in two cycles (MSB first).
  * @param data a word to write
  * @param mult the number of repeats 
  */
 void par_wr_mult(uint16_t  data, uint32_t mult)
 {
 #if PAR_SW != 0
-    par_sw_fill(0, data, mult);
+    par_sw_fill(act_adr, data, mult);
 #else
-    uint32_t i;
-    for(i = 0; i < mult; i++) {
-        psp_par_wr_array(0, &data, 1);
-    }
+    psp_par_fill(act_adr, data, mult);
 #endif 
 }
 
@@ -200,29 +343,31 @@ void par_wr_mult(uint16_t  data, uint32_t mult)
 static void par_sw_wr_array(uint32_t adr, const uint16_t * data_p, uint32_t length)
 {  
     uint32_t i;    
+
+    par_sw_set_adr(adr);
+
     uint32_t len_mod = length / BATCH_COM;
     
     /*In slow mode write data slowly*/
     if(slow_mode != 0) {
         for(i = 0; i < len_mod; i++) {
-            REPEATE8(REPEATE8(PARSW_SLOW_WR_DATA(data_p)));
+            REPEATE8(REPEATE8(PARSW_SLOW_WR_WORD(data_p)));
         }    
 
         len_mod = length % BATCH_COM;
         for(i = 0; i < len_mod; i++) {
-            PARSW_SLOW_WR_DATA(data_p)
+            PARSW_SLOW_WR_WORD(data_p)
         }
     } else { 
         /*In NOT slow mode write with max speed (in sw mode the max is slow too)*/
         
         for(i = 0; i < len_mod; i++) {
-            REPEATE8(REPEATE8(PARSW_WR_DATA(*data_p); data_p ++));
+            REPEATE8(REPEATE8(PARSW_WR_WORD(data_p)));
         }    
 
         len_mod = length % BATCH_COM;
         for(i = 0; i < len_mod; i++) {
-            PARSW_WR_DATA(*data_p);
-            data_p++;
+            PARSW_WR_WORD(data_p);
         }
     }
 }
@@ -230,9 +375,25 @@ static void par_sw_wr_array(uint32_t adr, const uint16_t * data_p, uint32_t leng
 static void par_sw_fill(uint32_t adr, uint16_t data, uint32_t length)
 {
     uint16_t * data_p = &data; 
+
+    if(length == 0) return;
+
+    par_sw_set_adr(adr);
+
+#if PAR_WIDTH == 8
+    if((data >> 8) != (data & 0xFF)) {
+        /*Different bytes: set the port for every cycle*/
+        par_sw_fill8(data, length);
+        return;
+    }
+
+    /*Same bytes: only strobes are required*/
+    data = data & 0xFF;
+    length = length << 1;
+#endif
+
     /* Write the first data, it will set the data port */
-    PARSW_WR_DATA(*data_p);
-    data_p++;
+    PARSW_WR_DATA(data_p);
     length --;
     
     uint32_t i;
@@ -261,27 +422,158 @@ static void par_sw_fill(uint32_t adr, uint16_t data, uint32_t length)
     }
 }
     
+
+static void par_sw_rd_array(uint32_t adr, uint16_t * data_p, uint32_t length)
+{
+    uint32_t i;
+
+    par_sw_set_adr(adr);
+    par_sw_rd_begin();
+
+    for(i = 0; i < length; i++) {
+#if PAR_WIDTH == 8
+        data_p[i] = (par_sw_rd_cycle() & 0xFF) << 8;
+        data_p[i] |= par_sw_rd_cycle() & 0xFF;
+#else
+        data_p[i] = par_sw_rd_cycle();
+#endif
+    }
+
+    par_sw_rd_end();
+}
+
+/**
+ * Write one bus word
+ * @param adr address of writing
+ * @param data the data to write
+ */
+static void par_sw_wr(uint32_t adr, uint16_t data)
+{
+    uint16_t * data_p = &data;
+
+    par_sw_set_adr(adr);
+
+    if(slow_mode != 0) {
+        PARSW_SLOW_WR_DATA(data_p);
+    } else {
+        PARSW_WR_DATA(data_p);
+    }
+}
+
+/**
+ * Read one bus word
+ * @param adr address of reading
+ * @return the read data
+ */
+static uint16_t par_sw_rd(uint32_t adr)
+{
+    uint16_t data;
+
+    par_sw_set_adr(adr);
+    par_sw_rd_begin();
+    data = par_sw_rd_cycle();
+    par_sw_rd_end();
+
+    return data;
+}
+
+/**
+ * Make a read cycle. Call between 'par_sw_rd_begin' and 'par_sw_rd_end'.
+ * @return the value of the data port
+ */
+static uint16_t par_sw_rd_cycle(void)
+{
+    uint16_t data;
+    uint16_t * data_p = &data;
+
+    if(slow_mode != 0) {
+        PARSW_SLOW_RD_DATA(data_p);
+    } else {
+        PARSW_RD_DATA(data_p);
+    }
+
+    return data;
+}
+
+/**
+ * Prepare the port for reading
+ */
+static void par_sw_rd_begin(void)
+{
+    io_set_port_dir(PARSW_DATA_PORT, IO_DIR_IN);
+#if PAR_MODE == PAR_MODE_6800
+    io_set_pin(PARSW_RD_PORT, PARSW_RD_PIN, 1);     /*R/W: read*/
+#endif
+}
+
+/**
+ * Set back the port for writing
+ */
+static void par_sw_rd_end(void)
+{
+#if PAR_MODE == PAR_MODE_6800
+    io_set_pin(PARSW_RD_PORT, PARSW_RD_PIN, PARSW_RD_IDLE);
+#endif
+    io_set_port_dir(PARSW_DATA_PORT, IO_DIR_OUT);
+}
+
+#if PAR_WIDTH == 8
+/**
+ * Write the same word with different bytes to 8 bit bus
+ * @param data the word to write (MSB first)
+ * @param length number of words
+ */
+static void par_sw_fill8(uint16_t data, uint32_t length)
+{
+    const uint16_t * data_p;
+    uint32_t i;
+
+    if(slow_mode != 0) {
+        for(i = 0; i < length; i++) {
+            data_p = &data;
+            PARSW_SLOW_WR_WORD(data_p);
+        }
+    } else {
+        for(i = 0; i < length; i++) {
+            data_p = &data;
+            PARSW_WR_WORD(data_p);
+        }
+    }
+}
+#endif
     
-#ifndef PARSW_WR_STROBE  
+#ifdef PARSW_WR_STROBE_FUNC
 /**
  * 
  */
 static void par_sw_wr_strobe(void)
 {
-    io_set_pin(PARSW_WR_PORT, PARSW_WR_PIN, 0);
-    io_set_pin(PARSW_WR_PORT, PARSW_WR_PIN, 1);
+    io_set_pin(PARSW_WR_PORT, PARSW_WR_PIN, PARSW_STB_ACT);
+    io_set_pin(PARSW_WR_PORT, PARSW_WR_PIN, !PARSW_STB_ACT);
 }
 #endif
 
+/**
+ * Set the address port if the address is changed
+ * @param adr the new address
+ */
+static inline void par_sw_set_adr(uint32_t adr)
+{
+    if(adr != sw_adr) {
+        io_set_port(PARSW_ADR_PORT, adr);
+        sw_adr = adr;
+    }
+}
+
 /**
  * 
  */
 static void par_sw_slow_wr_strobe(void)
 {
     tick_wait_us(1);
-    io_set_pin(PARSW_WR_PORT, PARSW_WR_PIN, 0);
+    io_set_pin(PARSW_WR_PORT, PARSW_WR_PIN, PARSW_STB_ACT);
     tick_wait_us(1);
-    io_set_pin(PARSW_WR_PORT, PARSW_WR_PIN, 1);
+    io_set_pin(PARSW_WR_PORT, PARSW_WR_PIN, !PARSW_STB_ACT);
 }
 
 #endif
@@ -37,11 +37,16 @@ typedef enum
 
 void par_init(void);
 void par_set_wait_time(uint8_t wait);
+void par_set_adr(uint32_t adr);
 void par_cs_en(par_cs_t cs);
 void par_cs_dis(par_cs_t cs);
 void par_wr(uint16_t data);
 void par_wr_array(uint16_t * data_p, uint32_t size);
 void par_wr_mult(uint16_t  data, uint32_t mult);
+uint16_t par_rd(void);
+void par_rd_array(uint16_t * data_p, uint32_t size);
+void par_wr_array_async(const uint16_t * data_p, uint32_t size, par_cb_t cb);
+bool par_busy(void);
 
 /**********************
  *      MACROS
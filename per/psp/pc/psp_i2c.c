@@ -0,0 +1,434 @@
+/**
+ * @file psp_i2c.c
+ * Simulated I2C buses on PC. The slaves are simulated by the application
+ * (see 'psp_i2c_set_sim'). Without a simulated slave every address is NACKed.
+ * The asynchronous transactions are executed by a thread per bus
+ * which waits for the time of the transfer on the real bus.
+ * With PSP_PC_VTIME every byte lets the virtual time pass and the asynchronous
+ * transactions are executed immediately (without thread).
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "hw_conf.h"
+#if USE_I2C != 0 && PSP_PC != 0
+
+#include <SDL2/SDL.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "../psp_i2c.h"
+#include "../psp_tmr.h"
+#include "hw/per/tick.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#ifndef I2C1_PRIO
+#define I2C1_PRIO   HW_INT_PRIO_OFF
+#endif
+#ifndef I2C2_PRIO
+#define I2C2_PRIO   HW_INT_PRIO_OFF
+#endif
+
+#define PSP_I2C_BYTE_BITS   9   /*8 data bit + ACK*/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+    uint32_t baud;
+    uint8_t prio;
+    const psp_i2c_sim_t * sim;
+    bool adr_next;          /*The next written byte is the address*/
+    bool addressed;         /*The simulated slave ACKed its address*/
+    SDL_mutex * bus;        /*Locked from start to stop*/
+    uint32_t tout_start;    /*Timeout of the current blocking transfer*/
+    uint32_t tout;
+    SDL_mutex * q_lock;
+    SDL_cond * q_cond;
+    i2c_trans_t * head;
+    i2c_trans_t * tail;
+#if PSP_PC_VTIME != 0
+    uint32_t vt_ns;         /*Not yet passed part of a microsecond*/
+    bool vt_run;            /*The queue is being executed*/
+#endif
+}m_dsc_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static int psp_i2c_thread(void * param);
+static hw_res_t psp_i2c_exec(i2c_t id, i2c_trans_t * t);
+static bool psp_i2c_tout(i2c_t id);
+#if PSP_PC_VTIME != 0
+static void psp_i2c_vt_run(i2c_t id);
+static void psp_i2c_vt_byte(m_dsc_t * dsc);
+#endif
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static m_dsc_t m_dsc[HW_I2C_NUM] =
+{
+    {I2C1_SW == 0 ? I2C1_BAUD : 0, I2C1_PRIO},   /*The software buses are handled by i2c.c*/
+    {I2C2_SW == 0 ? I2C2_BAUD : 0, I2C2_PRIO},
+};
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Initialize the simulated buses and start their threads
+ */
+void psp_i2c_init(void)
+{
+    i2c_t id;
+
+    for(id = HW_I2C1; id < HW_I2C_NUM; id++) {
+        if(m_dsc[id].baud == 0) continue;
+
+        m_dsc[id].bus = SDL_CreateMutex();
+        m_dsc[id].tout = UINT32_MAX;
+        m_dsc[id].q_lock = SDL_CreateMutex();
+        m_dsc[id].q_cond = SDL_CreateCond();
+
+        if(m_dsc[id].prio != HW_INT_PRIO_OFF && PSP_PC_VTIME == 0) {
+            SDL_CreateThread(psp_i2c_thread, "i2c_thread", (void *)(uintptr_t) id);
+        }
+    }
+}
+
+/**
+ * Set the simulated slave of a bus
+ * @param id id of an i2c (from i2c_t)
+ * @param sim pointer to a slave descriptor (only the pointer is saved) or NULL
+ */
+void psp_i2c_set_sim(i2c_t id, const psp_i2c_sim_t * sim)
+{
+    m_dsc[id].sim = sim;
+}
+
+/**
+ * Set the timeout of the next transfer. Only waiting for the bus can time out,
+ * the simulated slaves don't stretch the clock.
+ * @param id id of an i2c (from i2c_t)
+ * @param tout timeout in milliseconds (UINT32_MAX: no timeout)
+ */
+void psp_i2c_set_tout(i2c_t id, uint32_t tout)
+{
+#if USE_TICK != 0
+    m_dsc[id].tout_start = tick_get();
+    m_dsc[id].tout = tout;
+#else
+    m_dsc[id].tout_start = 0;
+    m_dsc[id].tout = UINT32_MAX;
+    (void) tout;
+#endif
+}
+
+/**
+ * The simulated bus can not be stuck, nothing to do
+ * @param id id of an i2c (from i2c_t)
+ * @param en true: enable, false: disable
+ */
+void psp_i2c_en(i2c_t id, bool en)
+{
+    (void) id;
+    (void) en;
+}
+
+/**
+ * Make a start condition. The bus is owned until the stop condition.
+ * Like on the MCUs it waits for the running asynchronous transaction within the timeout.
+ * @param id id of an i2c (from i2c_t)
+ * @return HW_RES_OK or any error from hw_res_t (HW_RES_TOUT: the bus was not released in time)
+ */
+hw_res_t psp_i2c_start(i2c_t id)
+{
+    if(m_dsc[id].baud == 0) return HW_RES_DIS;
+
+    while(SDL_TryLockMutex(m_dsc[id].bus) != 0) {
+        if(psp_i2c_tout(id) != false) return HW_RES_TOUT;
+        usleep(10);
+    }
+    m_dsc[id].adr_next = true;
+    m_dsc[id].addressed = false;
+
+    return HW_RES_OK;
+}
+
+/**
+ * Make a restart condition
+ * @param id id of an i2c (from i2c_t)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t psp_i2c_restart(i2c_t id)
+{
+    if(m_dsc[id].baud == 0) return HW_RES_DIS;
+
+    m_dsc[id].adr_next = true;
+
+    return HW_RES_OK;
+}
+
+/**
+ * Make a stop condition
+ * @param id id of an i2c (from i2c_t)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t psp_i2c_stop(i2c_t id)
+{
+    if(m_dsc[id].baud == 0) return HW_RES_DIS;
+
+    if(m_dsc[id].addressed != false && m_dsc[id].sim->stop != NULL) {
+        m_dsc[id].sim->stop();
+    }
+    m_dsc[id].addressed = false;
+    SDL_UnlockMutex(m_dsc[id].bus);
+
+    return HW_RES_OK;
+}
+
+/**
+ * Write a byte to the simulated bus
+ * @param id id of an i2c (from i2c_t)
+ * @param data byte to write
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t psp_i2c_wr(i2c_t id, uint8_t data)
+{
+    m_dsc_t * dsc = &m_dsc[id];
+    bool ack;
+
+    if(dsc->baud == 0) return HW_RES_DIS;
+
+#if PSP_PC_VTIME != 0
+    psp_i2c_vt_byte(dsc);
+#endif
+
+    if(dsc->adr_next != false) {
+        dsc->adr_next = false;
+        dsc->addressed = false;
+        if(dsc->sim != NULL && dsc->sim->adr == (data >> 1)) {
+            if(dsc->sim->start == NULL) dsc->addressed = true;
+            else dsc->addressed = dsc->sim->start(data & 0x01 ? true : false);
+        }
+        ack = dsc->addressed;
+    } else if(dsc->addressed != false) {
+        ack = dsc->sim->wr != NULL ? dsc->sim->wr(data) : true;
+    } else {
+        ack = false;
+    }
+
+    return ack != false ? HW_RES_OK : HW_RES_NO_ACK;
+}
+
+/**
+ * Read a byte from the simulated bus
+ * @param id id of an i2c (from i2c_t)
+ * @param data pointer to a variable to store the read data
+ * @param ack true: send ack, false: not sen ac
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t psp_i2c_rd(i2c_t id, uint8_t * data, bool ack)
+{
+    m_dsc_t * dsc = &m_dsc[id];
+
+    (void) ack;
+    if(dsc->baud == 0) return HW_RES_DIS;
+
+#if PSP_PC_VTIME != 0
+    psp_i2c_vt_byte(dsc);
+#endif
+
+    /*Nobody drives SDA*/
+    *data = 0xFF;
+    if(dsc->addressed != false && dsc->sim->rd != NULL) {
+        *data = dsc->sim->rd();
+    }
+
+    return HW_RES_OK;
+}
+
+/**
+ * Queue an asynchronous transaction
+ * @param id id of an i2c (from i2c_t)
+ * @param trans pointer to a transaction descriptor
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t psp_i2c_xfer_async(i2c_t id, i2c_trans_t * trans)
+{
+    m_dsc_t * dsc = &m_dsc[id];
+
+    if(dsc->baud == 0) return HW_RES_DIS;
+    if(dsc->prio == HW_INT_PRIO_OFF) return HW_RES_DIS;
+
+    trans->next = NULL;
+
+    SDL_LockMutex(dsc->q_lock);
+    if(dsc->head == NULL) dsc->head = trans;
+    else dsc->tail->next = trans;
+    dsc->tail = trans;
+    SDL_CondSignal(dsc->q_cond);
+    SDL_UnlockMutex(dsc->q_lock);
+
+#if PSP_PC_VTIME != 0
+    psp_i2c_vt_run(id);
+#endif
+
+    return HW_RES_OK;
+}
+
+/**
+ * Check the asynchronous queue
+ * @param id id of an i2c (from i2c_t)
+ * @return true: there are queued or running transactions
+ */
+bool psp_i2c_busy(i2c_t id)
+{
+    return m_dsc[id].head != NULL ? true : false;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Execute the queued transactions of a bus
+ * @param param the id of the bus (i2c_t)
+ * @return unused
+ */
+static int psp_i2c_thread(void * param)
+{
+    i2c_t id = (i2c_t)(uintptr_t) param;
+    m_dsc_t * dsc = &m_dsc[id];
+    i2c_trans_t * t;
+    hw_res_t res;
+
+    while(1) {
+        SDL_LockMutex(dsc->q_lock);
+        while(dsc->head == NULL) SDL_CondWait(dsc->q_cond, dsc->q_lock);
+        t = dsc->head;
+        SDL_UnlockMutex(dsc->q_lock);
+
+        res = psp_i2c_exec(id, t);
+
+        /*Remove from the queue before the callback to let it queue again*/
+        SDL_LockMutex(dsc->q_lock);
+        dsc->head = t->next;
+        SDL_UnlockMutex(dsc->q_lock);
+
+        if(t->cb != NULL) t->cb(t, res);
+    }
+
+    return 0;
+}
+
+/**
+ * Execute a transaction with the blocking functions
+ * @param id id of an i2c (from i2c_t)
+ * @param t pointer to the transaction
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+static hw_res_t psp_i2c_exec(i2c_t id, i2c_trans_t * t)
+{
+    hw_res_t res = HW_RES_OK;
+    uint16_t i;
+
+    /*The queue waits for the blocking transfers without timeout*/
+    SDL_LockMutex(m_dsc[id].bus);
+    m_dsc[id].adr_next = true;
+    m_dsc[id].addressed = false;
+
+    if(t->wr_len != 0) {
+        res = psp_i2c_wr(id, (t->adr << 1) & 0xFE);
+        for(i = 0; i < t->wr_len && res == HW_RES_OK; i++) {
+            res = psp_i2c_wr(id, t->wr_data[i]);
+        }
+        if(res == HW_RES_OK && t->rd_len != 0) res = psp_i2c_restart(id);
+    }
+
+    if(res == HW_RES_OK && t->rd_len != 0) {
+        res = psp_i2c_wr(id, (t->adr << 1) | 0x01);
+        for(i = 0; i < t->rd_len && res == HW_RES_OK; i++) {
+            res = psp_i2c_rd(id, &t->rd_data[i], i + 1 < t->rd_len ? true : false);
+        }
+    }
+
+#if PSP_PC_VTIME == 0
+    /*Hold the bus for the time of the transfer on the real bus (address bytes and data)*/
+    uint32_t bytes = t->wr_len + t->rd_len + (t->wr_len != 0 && t->rd_len != 0 ? 2 : 1);
+    usleep(((uint64_t) bytes * PSP_I2C_BYTE_BITS * 1000000) / m_dsc[id].baud);
+#endif
+
+    psp_i2c_stop(id);
+
+    return res;
+}
+
+/**
+ * Check the timeout of the current transfer and call the yield function while waiting
+ * @param id id of an i2c (from i2c_t)
+ * @return true: the timeout is elapsed
+ */
+static bool psp_i2c_tout(i2c_t id)
+{
+#if USE_TICK != 0
+    if(m_dsc[id].tout != UINT32_MAX &&
+       tick_elaps(m_dsc[id].tout_start) >= m_dsc[id].tout) {
+        return true;
+    }
+
+    tick_yield();
+#else
+    (void) id;
+#endif
+
+    return false;
+}
+
+#if PSP_PC_VTIME != 0
+/**
+ * Execute the queued transactions in virtual time.
+ * The transactions queued from the callbacks are executed by the outer call.
+ * @param id id of an i2c (from i2c_t)
+ */
+static void psp_i2c_vt_run(i2c_t id)
+{
+    m_dsc_t * dsc = &m_dsc[id];
+    i2c_trans_t * t;
+    hw_res_t res;
+
+    if(dsc->vt_run != false) return;
+
+    dsc->vt_run = true;
+    while(dsc->head != NULL) {
+        t = dsc->head;
+        res = psp_i2c_exec(id, t);      /*The bytes let the time pass*/
+        dsc->head = t->next;
+        if(t->cb != NULL) t->cb(t, res);
+    }
+    dsc->vt_run = false;
+}
+
+/**
+ * Let the virtual time of a byte pass
+ * @param dsc pointer to the bus' descriptor
+ */
+static void psp_i2c_vt_byte(m_dsc_t * dsc)
+{
+    dsc->vt_ns += (PSP_I2C_BYTE_BITS * 1000000000ULL) / dsc->baud;
+    psp_tmr_vt_adv(dsc->vt_ns / 1000);
+    dsc->vt_ns %= 1000;
+}
+#endif
+
+#endif
@@ -0,0 +1,392 @@
+/**
+ * @file psp_par.c
+ * Simulated parallel port on PC. The connected device is simulated by the
+ * application (see 'psp_par_set_sim'). Without a simulated device the written
+ * data is dropped and 0 is read.
+ * The asynchronous writes are executed by a thread which waits for the time
+ * of the transfer on the real bus.
+ * With PSP_PC_VTIME every word lets the virtual time pass and the asynchronous
+ * writes are executed immediately (without thread).
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "hw_conf.h"
+#if USE_PARALLEL != 0 && PSP_PC != 0
+
+#include <SDL2/SDL.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "../psp_par.h"
+#include "../psp_tmr.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#ifndef PAR_DMA_PRIO
+#define PAR_DMA_PRIO    HW_INT_PRIO_OFF
+#endif
+
+#ifndef PSP_PAR_WORD_NS
+#define PSP_PAR_WORD_NS     100     /*Time of a word on the simulated bus [ns]*/
+#endif
+
+#define PSP_PAR_CYCLES(words)   ((words) * (PAR_WIDTH == 8 ? 2 : 1))    /*Bus cycles of 16 bit words*/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+#if PAR_DMA_PRIO != HW_INT_PRIO_OFF && PSP_PC_VTIME == 0
+static int psp_par_thread(void * param);
+#endif
+static void psp_par_sim_wr(uint32_t adr, uint16_t data);
+static uint16_t psp_par_sim_rd(uint32_t adr);
+#if PSP_PC_VTIME != 0 && PAR_DMA_PRIO != HW_INT_PRIO_OFF
+static void psp_par_vt_run(void);
+#endif
+#if PSP_PC_VTIME != 0
+static void psp_par_vt_cycles(uint32_t cycles);
+#endif
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const psp_par_sim_t * sim;
+static volatile bool async_act;
+#if PAR_DMA_PRIO != HW_INT_PRIO_OFF
+static SDL_mutex * lock;
+static SDL_cond * cond;
+static uint32_t async_adr;
+static const uint16_t * async_buf;
+static uint32_t async_len;
+static par_cb_t async_cb;
+#endif
+#if PSP_PC_VTIME != 0
+static uint32_t vt_ns;      /*Not yet passed part of a microsecond*/
+#if PAR_DMA_PRIO != HW_INT_PRIO_OFF
+static bool vt_run;         /*The asynchronous writes are being executed*/
+#endif
+#endif
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Initialize the simulated parallel port
+ */
+void psp_par_init(void)
+{
+#if PAR_DMA_PRIO != HW_INT_PRIO_OFF
+    lock = SDL_CreateMutex();
+    cond = SDL_CreateCond();
+#if PSP_PC_VTIME == 0
+    SDL_CreateThread(psp_par_thread, "par_thread", NULL);
+#endif
+#endif
+}
+
+/**
+ * Set the simulated device
+ * @param s pointer to a device descriptor (only the pointer is saved) or NULL
+ */
+void psp_par_set_sim(const psp_par_sim_t * s)
+{
+    sim = s;
+}
+
+/**
+ * The timing is not simulated
+ * @param wait length of a wr/rd strobe in clock cycles
+ */
+void psp_par_set_wait_time(uint8_t wait)
+{
+    (void) wait;
+}
+
+/**
+ * Write one bus word (8 or 16 bit) to the simulated parallel port
+ * @param adr address of writing
+ * @param data the data to write
+ */
+void psp_par_wr(uint32_t adr, uint16_t data)
+{
+    while(async_act != false) usleep(10);
+
+#if PSP_PC_VTIME != 0
+    psp_par_vt_cycles(1);
+#endif
+
+    if(sim == NULL || sim->wr == NULL) return;
+
+    sim->wr(adr, data);
+}
+
+/**
+ * Read one bus word (8 or 16 bit) from the simulated parallel port
+ * @param adr address of reading
+ * @return the read data
+ */
+uint16_t psp_par_rd(uint32_t adr)
+{
+    while(async_act != false) usleep(10);
+
+#if PSP_PC_VTIME != 0
+    psp_par_vt_cycles(1);
+#endif
+
+    if(sim == NULL || sim->rd == NULL) return 0;
+
+    return sim->rd(adr);
+}
+
+/**
+ * Write an array to the simulated parallel port.
+ * With 8 bit bus every word is sent in two cycles (MSB first).
+ * @param adr start address of writing
+ * @param buf pointer to the array to write
+ * @param length length of the array in words
+ */
+void psp_par_wr_array(uint32_t adr, const void * buf, uint32_t length)
+{
+    const uint16_t * buf16_p = buf;
+    uint32_t i;
+
+    while(async_act != false) usleep(10);
+
+#if PSP_PC_VTIME != 0
+    psp_par_vt_cycles(PSP_PAR_CYCLES(length));
+#endif
+
+    if(sim == NULL || sim->wr == NULL) return;
+
+    for(i = 0; i < length; i++) {
+        psp_par_sim_wr(adr, buf16_p[i]);
+    }
+}
+
+/**
+ * Read data from the simulated parallel port.
+ * With 8 bit bus every word is read in two cycles (MSB first).
+ * @param adr start address of reading
+ * @param buf point to buffer to store the result
+ * @param length number of words to read
+ */
+void psp_par_rd_array(uint32_t adr, void * buf, uint32_t length)
+{
+    uint16_t * buf16_p = buf;
+    uint32_t i;
+
+    while(async_act != false) usleep(10);
+
+#if PSP_PC_VTIME != 0
+    psp_par_vt_cycles(PSP_PAR_CYCLES(length));
+#endif
+
+    for(i = 0; i < length; i++) {
+        buf16_p[i] = psp_par_sim_rd(adr);
+    }
+}
+
+/**
+ * Write the same word to the simulated parallel port multiple times.
+ * With 8 bit bus every word is sent in two cycles (MSB first).
+ * @param adr start address of writing
+ * @param data the word to write
+ * @param length number of words
+ */
+void psp_par_fill(uint32_t adr, uint16_t data, uint32_t length)
+{
+    uint32_t i;
+
+    while(async_act != false) usleep(10);
+
+#if PSP_PC_VTIME != 0
+    psp_par_vt_cycles(PSP_PAR_CYCLES(length));
+#endif
+
+    if(sim == NULL || sim->wr == NULL) return;
+
+    for(i = 0; i < length; i++) {
+        psp_par_sim_wr(adr, data);
+    }
+}
+
+/**
+ * Write an array to the simulated parallel port in the background.
+ * With 8 bit bus every word is sent in two cycles (MSB first).
+ * @param adr start address of writing
+ * @param buf pointer to the array to write. Has to be valid until 'cb' is called.
+ * @param length length of the array in words
+ * @param cb called from the port's thread when all the data is written (can be NULL)
+ * @return HW_RES_OK: the transfer is started,
+ *         HW_RES_DIS: the async. writes are disabled (PAR_DMA_PRIO), use 'psp_par_wr_array'
+ */
+hw_res_t psp_par_wr_array_async(uint32_t adr, const void * buf, uint32_t length, par_cb_t cb)
+{
+#if PAR_DMA_PRIO != HW_INT_PRIO_OFF
+    while(async_act != false) usleep(10);
+
+    SDL_LockMutex(lock);
+    async_adr = adr;
+    async_buf = buf;
+    async_len = length;
+    async_cb = cb;
+    async_act = true;
+    SDL_CondSignal(cond);
+    SDL_UnlockMutex(lock);
+
+#if PSP_PC_VTIME != 0
+    psp_par_vt_run();
+#endif
+
+    return HW_RES_OK;
+#else
+    (void) adr;
+    (void) buf;
+    (void) length;
+    (void) cb;
+    return HW_RES_DIS;
+#endif
+}
+
+/**
+ * Check the simulated parallel port
+ * @return true: an asynchronous write is in progress
+ */
+bool psp_par_busy(void)
+{
+    return async_act;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+#if PAR_DMA_PRIO != HW_INT_PRIO_OFF && PSP_PC_VTIME == 0
+/**
+ * Execute the asynchronous writes
+ * @param param unused
+ * @return unused
+ */
+static int psp_par_thread(void * param)
+{
+    uint32_t i;
+    par_cb_t cb;
+
+    (void) param;
+
+    while(1) {
+        SDL_LockMutex(lock);
+        while(async_act == false) SDL_CondWait(cond, lock);
+        SDL_UnlockMutex(lock);
+
+        if(sim != NULL && sim->wr != NULL) {
+            for(i = 0; i < async_len; i++) {
+                psp_par_sim_wr(async_adr, async_buf[i]);
+            }
+        }
+
+        /*Spend the time of the transfer on the real bus*/
+        usleep(((uint64_t) PSP_PAR_CYCLES(async_len) * PSP_PAR_WORD_NS) / 1000);
+
+        /*Free the port before the callback to let it start a new transfer*/
+        cb = async_cb;
+        async_act = false;
+        if(cb != NULL) cb();
+    }
+
+    return 0;
+}
+#endif
+
+#if PSP_PC_VTIME != 0 && PAR_DMA_PRIO != HW_INT_PRIO_OFF
+/**
+ * Execute the asynchronous writes in virtual time.
+ * A write started from the callback is executed by the outer call.
+ */
+static void psp_par_vt_run(void)
+{
+    uint32_t i;
+    par_cb_t cb;
+
+    if(vt_run != false) return;
+
+    vt_run = true;
+    while(async_act != false) {
+        if(sim != NULL && sim->wr != NULL) {
+            for(i = 0; i < async_len; i++) {
+                psp_par_sim_wr(async_adr, async_buf[i]);
+            }
+        }
+        psp_par_vt_cycles(PSP_PAR_CYCLES(async_len));
+
+        cb = async_cb;
+        async_act = false;
+        if(cb != NULL) cb();
+    }
+    vt_run = false;
+}
+#endif
+
+#if PSP_PC_VTIME != 0
+/**
+ * Let the virtual time of some bus cycles pass
+ * @param cycles number of bus cycles
+ */
+static void psp_par_vt_cycles(uint32_t cycles)
+{
+    uint64_t ns = vt_ns + (uint64_t) cycles * PSP_PAR_WORD_NS;
+
+    psp_tmr_vt_adv(ns / 1000);
+    vt_ns = ns % 1000;
+}
+#endif
+
+/**
+ * Write a word to the simulated device (in two bytes on 8 bit bus)
+ * @param adr address of writing
+ * @param data the word to write
+ */
+static void psp_par_sim_wr(uint32_t adr, uint16_t data)
+{
+#if PAR_WIDTH == 8
+    sim->wr(adr, data >> 8);
+    sim->wr(adr, data & 0xFF);
+#else
+    sim->wr(adr, data);
+#endif
+}
+
+/**
+ * Read a word from the simulated device (in two bytes on 8 bit bus)
+ * @param adr address of reading
+ * @return the read word
+ */
+static uint16_t psp_par_sim_rd(uint32_t adr)
+{
+    uint16_t data;
+
+    if(sim == NULL || sim->rd == NULL) return 0;
+
+#if PAR_WIDTH == 8
+    data = (sim->rd(adr) & 0xFF) << 8;
+    data |= sim->rd(adr) & 0xFF;
+#else
+    data = sim->rd(adr);
+#endif
+
+    return data;
+}
+
+#endif
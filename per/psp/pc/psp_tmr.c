@@ -1,5 +1,9 @@
 /**
  * @file psp_tmr.c
+ * Simulated timers on PC. By default one thread calls the timers at their
+ * real-time deadlines. With PSP_PC_VTIME the time is virtual: it passes only
+ * by 'psp_tmr_vt_adv' (e.g. from 'tick_wait_ms') and the callbacks are
+ * called from there. It makes the simulation fast and reproducible.
  */
 
 /***********************
@@ -13,12 +17,19 @@
 #include <pthread.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <time.h>
+#include <string.h>
 #include "hw/per/tmr.h"
 
 /***********************
  *       DEFINES
  ***********************/
 #define TMR_DEF_PERIOD 1000	/*us*/
+#define TMR_MAX_SLEEP  1000	/*Check the started timers at least this often [us]*/
+
+#ifndef TMR_IC_PRIO
+#define TMR_IC_PRIO     HW_INT_PRIO_OFF
+#endif
 
 /***********************
  *       TYPEDEFS
@@ -28,6 +39,12 @@ typedef struct
 	uint32_t period;
 	void(*fp)(void);
 	bool run;
+	uint64_t next;			/*Deadline of the next callback [us]*/
+	uint64_t last;			/*Deadline of the last callback [us]*/
+	SDL_mutex * lock;		/*Held while the callback runs or the "interrupt" is disabled*/
+	volatile bool int_dis;
+	SDL_threadID dis_thread;	/*The thread which disabled the "interrupt"*/
+	psp_tmr_stat_t stat;
 }mdsc_t;
 
 /***********************
@@ -42,6 +59,28 @@ static mdsc_t mdsc[HW_TMR_NUM] = {
 		{TMR_DEF_PERIOD, NULL, false},
 };
 
+typedef struct
+{
+	tmr_t oc_tmr;
+	uint16_t duty;
+	tmr_t ic_tmr;
+	tmr_ic_edge_t edge;
+	tmr_ic_cb_t ic_cb;
+}ch_dsc_t;
+
+static ch_dsc_t ch_dsc[HW_TMR_CH_NUM] = {
+		{HW_TMRX, 0, HW_TMRX},
+		{HW_TMRX, 0, HW_TMRX},
+		{HW_TMRX, 0, HW_TMRX},
+		{HW_TMRX, 0, HW_TMRX},
+		{HW_TMRX, 0, HW_TMRX},
+};
+
+#if PSP_PC_VTIME != 0
+static uint64_t vt_now;		/*The virtual time [us]*/
+static bool vt_in_cb;		/*A timer callback is running*/
+#endif
+
 /***********************
  *   GLOBAL PROTOTYPES
  ***********************/
@@ -49,18 +88,29 @@ static mdsc_t mdsc[HW_TMR_NUM] = {
 /***********************
  *   STATIC PROTOTYPES
  ***********************/
+#if PSP_PC_VTIME == 0
 static int tmr_han(void * param);
+#endif
+static void tmr_call(mdsc_t * m, uint64_t now);
+static uint64_t tmr_now(void);
 
 /***********************
  *   GLOBAL FUNCTIONS
  ***********************/
 
+/**
+ * Initialize the simulated timers. One thread serves all of them (if not in virtual time).
+ */
 void psp_tmr_init(void)
 {
 	uint8_t i;
 	for(i = 0; i < HW_TMR_NUM; i++) {
-		SDL_CreateThread(tmr_han, "tmr_han", &mdsc[i]);
+		mdsc[i].lock = SDL_CreateMutex();
 	}
+
+#if PSP_PC_VTIME == 0
+	SDL_CreateThread(tmr_han, "tmr_han", NULL);
+#endif
 }
 
 hw_res_t psp_tmr_set_period(tmr_t tmr, uint32_t p_us)
@@ -70,6 +120,13 @@ hw_res_t psp_tmr_set_period(tmr_t tmr, uint32_t p_us)
 	return HW_RES_OK;
 }
 
+void psp_tmr_set_value(tmr_t tmr, uint32_t value)
+{
+	/*The simulated counter counts in microseconds*/
+	mdsc[tmr].last = tmr_now() - value;
+	mdsc[tmr].next = mdsc[tmr].last + mdsc[tmr].period;
+}
+
 void psp_tmr_set_cb(tmr_t tmr, void (*cb) (void))
 {
 	mdsc[tmr].fp = cb;
@@ -77,36 +134,308 @@ void psp_tmr_set_cb(tmr_t tmr, void (*cb) (void))
 
 void psp_tmr_en_int(tmr_t tmr, bool en)
 {
+	if(mdsc[tmr].lock == NULL) return;
 
+	/*Block the timer's thread like a disabled interrupt. 
+	 *Like on the MCUs repeated disables of the same thread don't need more enables.
+	 *An other thread waits until the "interrupt" is enabled again.*/
+	bool own = mdsc[tmr].int_dis != false && mdsc[tmr].dis_thread == SDL_ThreadID();
+	if(en == false && own == false) {
+		SDL_LockMutex(mdsc[tmr].lock);
+		mdsc[tmr].dis_thread = SDL_ThreadID();
+		mdsc[tmr].int_dis = true;
+	} else if(en != false && own != false) {
+		mdsc[tmr].int_dis = false;
+		mdsc[tmr].dis_thread = 0;
+		SDL_UnlockMutex(mdsc[tmr].lock);
+#if PSP_PC_VTIME != 0
+		psp_tmr_vt_adv(0);		/*Call the callbacks became due while disabled*/
+#endif
+	}
 }
 
 void psp_tmr_run(tmr_t tmr, bool en)
 {
+	if(en != false && mdsc[tmr].run == false) {
+		mdsc[tmr].last = tmr_now();
+		mdsc[tmr].next = mdsc[tmr].last + mdsc[tmr].period;
+	}
 	mdsc[tmr].run = en;
 }
 
+uint32_t psp_tmr_get_us(tmr_t tmr)
+{
+	uint64_t now = tmr_now();
+	uint64_t us;
+
+	/*The thread might be late. Don't count into the next period to keep the time monotonic*/
+	if(now < mdsc[tmr].last) return 0;
+	us = now - mdsc[tmr].last;
+	if(us >= mdsc[tmr].period) us = mdsc[tmr].period - 1;
+
+	return us;
+}
+
+/**
+ * Get the timing statistics of a simulated timer
+ * @param tmr id of the timer
+ * @param st pointer to a variable to store the statistics
+ */
+void psp_tmr_get_stat(tmr_t tmr, psp_tmr_stat_t * st)
+{
+	SDL_LockMutex(mdsc[tmr].lock);
+	*st = mdsc[tmr].stat;
+	SDL_UnlockMutex(mdsc[tmr].lock);
+}
+
+/**
+ * Clear the timing statistics of a simulated timer
+ * @param tmr id of the timer
+ */
+void psp_tmr_clr_stat(tmr_t tmr)
+{
+	SDL_LockMutex(mdsc[tmr].lock);
+	memset(&mdsc[tmr].stat, 0, sizeof(psp_tmr_stat_t));
+	SDL_UnlockMutex(mdsc[tmr].lock);
+}
+
+/**
+ * Start a simulated PWM output (only the duty cycle is stored, see 'psp_tmr_pwm_get')
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param tmr the id of a timer as time base (HW_TMR2 or HW_TMR3 like on the PIC32)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t psp_tmr_pwm_init(tmr_ch_t ch, tmr_t tmr)
+{
+	if(tmr >= HW_TMR_NUM) return HW_RES_NOT_EX;
+	if(tmr != HW_TMR2 && tmr != HW_TMR3) return HW_RES_INV_PARAM;
+
+	ch_dsc[ch].oc_tmr = tmr;
+	ch_dsc[ch].duty = 0;
+
+	return HW_RES_OK;
+}
+
+/**
+ * Set the duty cycle of a simulated PWM output
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param duty high time in 1/65536 of the period
+ * @return HW_RES_OK or HW_RES_NOT_RDY if not started
+ */
+hw_res_t psp_tmr_pwm_set(tmr_ch_t ch, uint16_t duty)
+{
+	if(ch_dsc[ch].oc_tmr == HW_TMRX) return HW_RES_NOT_RDY;
+
+	ch_dsc[ch].duty = duty;
+
+	return HW_RES_OK;
+}
+
+/**
+ * Stop a simulated PWM output
+ * @param ch the id of a channel (HW_TMR_CHx)
+ */
+void psp_tmr_pwm_stop(tmr_ch_t ch)
+{
+	ch_dsc[ch].oc_tmr = HW_TMRX;
+	ch_dsc[ch].duty = 0;
+}
+
+/**
+ * Get the duty cycle of a simulated PWM output (e.g. to draw a backlight)
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @return the duty cycle in 1/65536 of the period, 0 if stopped
+ */
+uint16_t psp_tmr_pwm_get(tmr_ch_t ch)
+{
+	return ch_dsc[ch].duty;
+}
+
+/**
+ * Start a simulated input capture. The edges are made by 'psp_tmr_ic_sim'.
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param tmr the id of a timer as time base (HW_TMR2 or HW_TMR3 like on the PIC32)
+ * @param edge the edges to capture
+ * @param cb called with the time of every edge
+ * @return HW_RES_OK or any error from hw_res_t (HW_RES_DIS if TMR_IC_PRIO is HW_INT_PRIO_OFF)
+ */
+hw_res_t psp_tmr_ic_init(tmr_ch_t ch, tmr_t tmr, tmr_ic_edge_t edge, tmr_ic_cb_t cb)
+{
+#if TMR_IC_PRIO != HW_INT_PRIO_OFF
+	if(tmr >= HW_TMR_NUM) return HW_RES_NOT_EX;
+	if(tmr != HW_TMR2 && tmr != HW_TMR3) return HW_RES_INV_PARAM;
+
+	ch_dsc[ch].ic_tmr = tmr;
+	ch_dsc[ch].edge = edge;
+	ch_dsc[ch].ic_cb = cb;
+
+	return HW_RES_OK;
+#else
+	(void) ch;
+	(void) tmr;
+	(void) edge;
+	(void) cb;
+	return HW_RES_DIS;
+#endif
+}
+
+/**
+ * Stop a simulated input capture
+ * @param ch the id of a channel (HW_TMR_CHx)
+ */
+void psp_tmr_ic_stop(tmr_ch_t ch)
+{
+	ch_dsc[ch].ic_cb = NULL;
+}
+
+/**
+ * Simulate an edge on an input capture channel.
+ * The callback is called immediately with the actual time of the timer.
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param rise true: rising edge, false: falling edge
+ */
+void psp_tmr_ic_sim(tmr_ch_t ch, bool rise)
+{
+	ch_dsc_t * dsc = &ch_dsc[ch];
+
+	if(dsc->ic_cb == NULL) return;
+	if(dsc->edge == TMR_IC_RISE && rise == false) return;
+	if(dsc->edge == TMR_IC_FALL && rise != false) return;
+
+	dsc->ic_cb(ch, psp_tmr_get_us(dsc->ic_tmr));
+}
+
+#if PSP_PC_VTIME != 0
+/**
+ * Let the virtual time pass and call the timers which became due meanwhile
+ * (in the order of their deadlines). Called from a timer callback only the time passes
+ * and the due timers are called after the callback, like pending interrupts.
+ * @param us the time to pass [us]
+ */
+void psp_tmr_vt_adv(uint32_t us)
+{
+	uint64_t end = vt_now + us;
+	mdsc_t * m;
+	mdsc_t * first;
+	uint8_t i;
+
+	if(vt_in_cb != false) {
+		vt_now = end;
+		return;
+	}
+
+	while(1) {
+		first = NULL;
+		for(i = 0; i < HW_TMR_NUM; i++) {
+			m = &mdsc[i];
+			if(m->run == false || m->fp == NULL || m->int_dis != false) continue;
+			if(m->next > end && m->next > vt_now) continue;
+			if(first == NULL || m->next < first->next) first = m;
+		}
+		if(first == NULL) break;
+
+		if(first->next > vt_now) vt_now = first->next;
+		vt_in_cb = true;
+		tmr_call(first, vt_now);
+		vt_in_cb = false;
+	}
+
+	if(vt_now < end) vt_now = end;
+}
+
+/**
+ * Get the virtual time
+ * @return the virtual time since start [us]
+ */
+uint64_t psp_tmr_vt_get(void)
+{
+	return vt_now;
+}
+#endif
 
 /***********************
  *   STATIC FUNCTIONS
  ***********************/
+
+#if PSP_PC_VTIME == 0
+/**
+ * Call the timers at their absolute deadlines. The deadlines are advanced
+ * by the period (not from the actual time) so the timers don't drift.
+ * If the thread was late with more periods the missed callbacks are caught up.
+ * @param param unused
+ * @return unused
+ */
 static int tmr_han(void * param)
 {
-	mdsc_t *  my_modul = param;
+	struct timespec ts;
+	uint64_t wake;
+	uint64_t now;
+	mdsc_t * m;
+	uint8_t i;
+
+	(void) param;
 
 	while(1) {
-		if(my_modul->run != false) {
-			if(my_modul->fp != NULL) {
-				my_modul->fp();
-				usleep(my_modul->period);
-			} else {
-				usleep(TMR_DEF_PERIOD);
-			}
-		} else {
-			usleep(TMR_DEF_PERIOD);
+		/*Sleep until the nearest deadline but check the newly started timers too*/
+		wake = tmr_now() + TMR_MAX_SLEEP;
+		for(i = 0; i < HW_TMR_NUM; i++) {
+			m = &mdsc[i];
+			if(m->run == false || m->fp == NULL) continue;
+			if(m->next < wake) wake = m->next;
+		}
+		ts.tv_sec = wake / 1000000;
+		ts.tv_nsec = (wake % 1000000) * 1000;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+		now = tmr_now();
+		for(i = 0; i < HW_TMR_NUM; i++) {
+			m = &mdsc[i];
+			if(m->run == false || m->fp == NULL) continue;
+			if(m->next > now) continue;
+
+			SDL_LockMutex(m->lock);
+			tmr_call(m, now);
+			SDL_UnlockMutex(m->lock);
 		}
 	}
 
 	return 0;
 }
+#endif
+
+/**
+ * Call a due timer, update its statistics and deadline
+ * @param m pointer to the timer's descriptor
+ * @param now the actual time [us]
+ */
+static void tmr_call(mdsc_t * m, uint64_t now)
+{
+	uint64_t late = now - m->next;
+
+	m->stat.calls++;
+	m->stat.late_sum += late;
+	if(late > m->stat.late_max) m->stat.late_max = late;
+	if(late >= m->period) m->stat.missed++;
+	m->last = m->next;
+	m->next += m->period;
+	m->fp();
+}
+
+/**
+ * Get the actual time of the timers
+ * @return the virtual time or the monotonic system time [us]
+ */
+static uint64_t tmr_now(void)
+{
+#if PSP_PC_VTIME != 0
+	return vt_now;
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+}
 
 #endif
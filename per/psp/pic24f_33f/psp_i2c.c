@@ -14,6 +14,7 @@
 #include <xc.h>
 #include <stddef.h>
 #include "../psp_i2c.h"
+#include "hw/per/tick.h"
 
 /*********************
  *      DEFINES
@@ -32,9 +33,41 @@
 
 #define PSP_I2C_BRG_MAX     511 
 
+#ifndef I2C1_PRIO
+#define I2C1_PRIO   HW_INT_PRIO_OFF
+#endif
+#ifndef I2C2_PRIO
+#define I2C2_PRIO   HW_INT_PRIO_OFF
+#endif
+
+#define I2C1_IF     IFS1bits.MI2C1IF
+#define I2C1_IE     IEC1bits.MI2C1IE
+#define I2C1_IP     IPC4bits.MI2C1IP
+
+#define I2C2_IF     IFS3bits.MI2C2IF
+#define I2C2_IE     IEC3bits.MI2C2IE
+#define I2C2_IP     IPC12bits.MI2C2IP
+
+/*The deadline of the asynchronous transactions is checked by a tick timer*/
+#define PSP_I2C_ASYNC_DL    (USE_TICK != 0 && ((I2C1_BAUD != 0 && I2C1_SW == 0 && I2C1_PRIO != HW_INT_PRIO_OFF) || \
+                                               (I2C2_BAUD != 0 && I2C2_SW == 0 && I2C2_PRIO != HW_INT_PRIO_OFF)))
+
 /**********************
  *      TYPEDEFS
  **********************/
+/*States of the asynchronous transfer. The state shows what was started last*/
+typedef enum
+{
+    PSP_I2C_ST_IDLE = 0,
+    PSP_I2C_ST_START,
+    PSP_I2C_ST_WR,          /*Address for write or a data byte was sent*/
+    PSP_I2C_ST_RESTART,
+    PSP_I2C_ST_ADR_RD,
+    PSP_I2C_ST_RD,
+    PSP_I2C_ST_ACK,
+    PSP_I2C_ST_STOP,
+}psp_i2c_st_t;
+
 typedef struct
 {
     /*Registers*/
@@ -46,31 +79,58 @@ typedef struct
     
     /*Settings*/
     uint32_t baud;
+    uint8_t prio;
+    
+    /*Timeout of the current transfer*/
+    uint32_t tout_start;
+    uint32_t tout;
+    
+    /*Asynchronous transfers*/
+    i2c_trans_t * head;     /*The running transaction*/
+    i2c_trans_t * tail;
+    volatile psp_i2c_st_t state;
+    uint16_t idx;
+    hw_res_t res;
+    volatile bool sync_act; /*A blocking transfer is in progress*/
+    uint32_t async_start;   /*Start time of the running transaction*/
 }m_dsc_t;
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 static hw_res_t psp_i2c_idle(i2c_t id);
+static bool psp_i2c_tout(i2c_t id);
+static void psp_i2c_async_next(i2c_t id);
+static void psp_i2c_async_handler(i2c_t id);
+static void psp_i2c_async_stop(i2c_t id, hw_res_t res);
+static void psp_i2c_int_en(i2c_t id, bool en);
+static void psp_i2c_int_clr(i2c_t id);
+#if PSP_I2C_ASYNC_DL != 0
+static void psp_i2c_async_dl(void * ctx);
+#endif
 
 /**********************
  *  STATIC VARIABLES
  **********************/
 static m_dsc_t m_dsc[] = 
 {
-        /*CON*/                                                  /*STAT*/        /*BRG*/    /*TRN*/   /*RCV*/   /*baud*/
-#if I2C1_BAUD != 0
-   {(MY_I2CXCON_T(MY_I2CXCON(1)) * ) &MY_I2CXCON(1), (I2C1STATBITS *) &I2C1STAT, &I2C1BRG, &I2C1TRN, &I2C1RCV, I2C1_BAUD},   
+        /*CON*/                                                  /*STAT*/        /*BRG*/    /*TRN*/   /*RCV*/   /*baud*/   /*prio*/
+#if I2C1_BAUD != 0 && I2C1_SW == 0
+   {(MY_I2CXCON_T(MY_I2CXCON(1)) * ) &MY_I2CXCON(1), (I2C1STATBITS *) &I2C1STAT, &I2C1BRG, &I2C1TRN, &I2C1RCV, I2C1_BAUD, I2C1_PRIO, 0, UINT32_MAX},   
 #else
-   {NULL,                       NULL,                      NULL,    NULL,       NULL,    0},
+   {NULL,                       NULL,                      NULL,    NULL,       NULL,    0, HW_INT_PRIO_OFF, 0, UINT32_MAX},
 #endif
-#if I2C2_BAUD != 0
-   {(MY_I2CXCON_T(MY_I2CXCON(1)) * ) &MY_I2CXCON(2), (I2C1STATBITS *) &I2C2STAT, &I2C2BRG, &I2C2TRN, &I2C2RCV, I2C2_BAUD}, 
+#if I2C2_BAUD != 0 && I2C2_SW == 0
+   {(MY_I2CXCON_T(MY_I2CXCON(1)) * ) &MY_I2CXCON(2), (I2C1STATBITS *) &I2C2STAT, &I2C2BRG, &I2C2TRN, &I2C2RCV, I2C2_BAUD, I2C2_PRIO, 0, UINT32_MAX}, 
 #else
-   {NULL,                       NULL,                      NULL,    NULL,       NULL,    0},
+   {NULL,                       NULL,                      NULL,    NULL,       NULL,    0, HW_INT_PRIO_OFF, 0, UINT32_MAX},
 #endif   
 };
 
+#if PSP_I2C_ASYNC_DL != 0
+static tick_tmr_t dl_tmr[HW_I2C_NUM];
+#endif
+
 /**********************
  *      MACROS
  **********************/
@@ -97,8 +157,61 @@ void psp_i2c_init(void)
             *m_dsc[i].I2CxBRG = baud;            
         }
     }
+    
+    /*The master interrupt drives the asynchronous transfers*/
+#if I2C1_BAUD != 0 && I2C1_SW == 0 && I2C1_PRIO != HW_INT_PRIO_OFF
+    I2C1_IF = 0;
+    I2C1_IP = I2C1_PRIO;
+    I2C1_IE = 1;
+#endif
+#if I2C2_BAUD != 0 && I2C2_SW == 0 && I2C2_PRIO != HW_INT_PRIO_OFF
+    I2C2_IF = 0;
+    I2C2_IP = I2C2_PRIO;
+    I2C2_IE = 1;
+#endif
+
+#if PSP_I2C_ASYNC_DL != 0
+    /*Check the deadline of the asynchronous transactions periodically.
+     *(Starting a timer per transaction is not allowed from the I2C interrupt.)*/
+    for(i = HW_I2C1; i < HW_I2C_NUM; i++) {
+        if(m_dsc[i].I2CxCON == NULL || m_dsc[i].prio == HW_INT_PRIO_OFF) continue;
+        tick_tmr_init(&dl_tmr[i], psp_i2c_async_dl, (void *)(uintptr_t) i);
+        tick_tmr_start(&dl_tmr[i], 1, 1);
+    }
+#endif
 }
 
+/**
+ * Set the timeout of the next transfer. The waiting functions return with HW_RES_TOUT
+ * if they are called after 'tout' milliseconds from now.
+ * @param id id of an i2c (from i2c_t)
+ * @param tout timeout in milliseconds (UINT32_MAX: no timeout)
+ */
+void psp_i2c_set_tout(i2c_t id, uint32_t tout)
+{
+#if USE_TICK != 0
+    m_dsc[id].tout_start = tick_get();
+    m_dsc[id].tout = tout;
+#else
+    /*Without tick the timeout is not supported*/
+    m_dsc[id].tout_start = 0;
+    m_dsc[id].tout = UINT32_MAX;
+    (void) tout;
+#endif
+}
+
+/**
+ * Enable or disable an i2c module. When disabled its pins can be used as io.
+ * The module's state machine is reset too.
+ * @param id id of an i2c (from i2c_t)
+ * @param en true: enable, false: disable
+ */
+void psp_i2c_en(i2c_t id, bool en)
+{
+    if(m_dsc[id].I2CxCON == NULL) return;
+    
+    m_dsc[id].I2CxCON->I2CEN = en != false ? 1 : 0;
+}
 
 /**
  * Make a start condition
@@ -111,9 +224,31 @@ hw_res_t psp_i2c_start(i2c_t id)
         
     /*If a register is NULL then the module is disabled*/
     if(m_dsc[id].I2CxCON != NULL) {
+        /*Don't start more queued transactions and wait for the running one*/
+        psp_i2c_int_en(id, false);
+        m_dsc[id].sync_act = true;
+        psp_i2c_int_en(id, true);
+        while(m_dsc[id].state != PSP_I2C_ST_IDLE) {
+            if(psp_i2c_tout(id) != false) {
+                psp_i2c_int_en(id, false);
+                m_dsc[id].sync_act = false;
+                if(m_dsc[id].state == PSP_I2C_ST_IDLE) psp_i2c_async_next(id);
+                psp_i2c_int_en(id, true);
+                return HW_RES_TOUT;
+            }
+        }
+        
         m_dsc[id].I2CxCON->SEN = 1;          /* Set start condition */
-        while (m_dsc[id].I2CxCON->SEN == 1); /* Wait till start condition is cleared */
-        psp_i2c_idle(id);
+        while (m_dsc[id].I2CxCON->SEN == 1) { /* Wait till start condition is cleared */
+            if(psp_i2c_tout(id) != false) return HW_RES_TOUT;
+        }
+        
+        /*SDA or SCL was low: the start is aborted*/
+        if(m_dsc[id].I2CxSTAT->BCL != 0) {
+            m_dsc[id].I2CxSTAT->BCL = 0;
+            return HW_RES_NOT_RDY;
+        }
+        res = psp_i2c_idle(id);
     } else {
         res = HW_RES_DIS;
     }
@@ -132,8 +267,10 @@ hw_res_t psp_i2c_restart(i2c_t id)
     /*If a register is NULL then the module is disabled*/
     if(m_dsc[id].I2CxCON != NULL) {
         m_dsc[id].I2CxCON->RSEN = 1;                       /* Set restart condition */
-        while (m_dsc[id].I2CxCON->RSEN == 1);              /* Wait till restart condition is cleared */
-        psp_i2c_idle(id);  
+        while (m_dsc[id].I2CxCON->RSEN == 1) {             /* Wait till restart condition is cleared */
+            if(psp_i2c_tout(id) != false) return HW_RES_TOUT;
+        }
+        res = psp_i2c_idle(id);
     } else {
         res = HW_RES_DIS;
     }
@@ -152,9 +289,23 @@ hw_res_t psp_i2c_stop(i2c_t id)
 
     /*If a register is NULL then the module is disabled*/
     if(m_dsc[id].I2CxCON != NULL) {
+        /*Do not disturb an asynchronous transfer if the start failed*/
+        if(m_dsc[id].sync_act == false) return HW_RES_NOT_RDY;
+        
         m_dsc[id].I2CxCON->PEN = 1;                        /* Set stop condition */
-        while (m_dsc[id].I2CxCON->PEN == 1);               /* Wait till stop condition is cleared*/
-        psp_i2c_idle(id);
+        while (m_dsc[id].I2CxCON->PEN == 1) {              /* Wait till stop condition is cleared*/
+            if(psp_i2c_tout(id) != false) {
+                res = HW_RES_TOUT;
+                break;
+            }
+        }
+        if(res == HW_RES_OK) res = psp_i2c_idle(id);
+        
+        /*Start the transactions queued meanwhile*/
+        psp_i2c_int_en(id, false);
+        m_dsc[id].sync_act = false;
+        if(m_dsc[id].state == PSP_I2C_ST_IDLE) psp_i2c_async_next(id);
+        psp_i2c_int_en(id, true);
     } else {
         res = HW_RES_DIS;
     }
@@ -175,8 +326,11 @@ hw_res_t psp_i2c_wr(i2c_t id, uint8_t data)
     /*If a register is NULL then the module is disabled*/
     if(m_dsc[id].I2CxCON != NULL) {
         *(m_dsc[id].I2CxTRN) = data;             /* Write data into register */
-        while (m_dsc[id].I2CxSTAT->TRSTAT == 1); /* Wait till transmit is in progress */
-        psp_i2c_idle(id);   /* wait for bus idle */
+        while (m_dsc[id].I2CxSTAT->TRSTAT == 1) { /* Wait till transmit is in progress */
+            if(psp_i2c_tout(id) != false) return HW_RES_TOUT;
+        }
+        res = psp_i2c_idle(id);   /* wait for bus idle */
+        if(res != HW_RES_OK) return res;
         if(m_dsc[id].I2CxSTAT->ACKSTAT != 0) return HW_RES_NO_ACK;
     } else {
         res = HW_RES_DIS;
@@ -198,17 +352,17 @@ hw_res_t psp_i2c_rd(i2c_t id, uint8_t * data, bool ack)
         
     /*If a register is NULL then the module is disabled*/
     if(m_dsc[id].I2CxCON != NULL) {
-        psp_i2c_idle(id );               /* wait for bus idle */    
+        res = psp_i2c_idle(id );         /* wait for bus idle */    
+        if(res != HW_RES_OK) return res;
         m_dsc[id].I2CxCON->RCEN = 1;            /* enable receive */    
-        while (m_dsc[id].I2CxCON->RCEN); /* wait for receive buffer full */    
+        while (m_dsc[id].I2CxCON->RCEN) { /* wait for receive buffer full */    
+            if(psp_i2c_tout(id) != false) return HW_RES_TOUT;
+        }
         *data = *(m_dsc[id].I2CxRCV);    /* read the data */    
 
-        /* send or not an ACK */
-        if (ack != false) {        
-           m_dsc[id].I2CxCON->ACKEN = 1;    /* send acknoledgement */
-        } else {        
-            m_dsc[id].I2CxCON->ACKEN = 0;   /* no acknoledgement */
-        }        
+        /* send an ACK or a NACK (on the last byte) */
+        m_dsc[id].I2CxCON->ACKDT = ack != false ? 0 : 1;
+        m_dsc[id].I2CxCON->ACKEN = 1;
     } else {
         res = HW_RES_DIS;
     }
@@ -216,6 +370,65 @@ hw_res_t psp_i2c_rd(i2c_t id, uint8_t * data, bool ack)
     return res;
 }
 
+/**
+ * Queue an asynchronous transaction
+ * @param id id of an i2c (from i2c_t)
+ * @param trans pointer to a transaction descriptor
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t psp_i2c_xfer_async(i2c_t id, i2c_trans_t * trans)
+{
+    if(m_dsc[id].I2CxCON == NULL) return HW_RES_DIS;
+    if(m_dsc[id].prio == HW_INT_PRIO_OFF) return HW_RES_DIS;
+    
+    trans->next = NULL;
+    
+    psp_i2c_int_en(id, false);
+    if(m_dsc[id].head == NULL) m_dsc[id].head = trans;
+    else m_dsc[id].tail->next = trans;
+    m_dsc[id].tail = trans;
+    
+    /*Start it now if the bus is free*/
+    if(m_dsc[id].state == PSP_I2C_ST_IDLE && m_dsc[id].sync_act == false) {
+        psp_i2c_async_next(id);
+    }
+    psp_i2c_int_en(id, true);
+    
+    return HW_RES_OK;
+}
+
+/**
+ * Check the asynchronous queue
+ * @param id id of an i2c (from i2c_t)
+ * @return true: there are queued or running transactions
+ */
+bool psp_i2c_busy(i2c_t id)
+{
+    return m_dsc[id].head != NULL ? true : false;
+}
+
+#if I2C1_BAUD != 0 && I2C1_SW == 0 && I2C1_PRIO != HW_INT_PRIO_OFF
+/**
+ * Called when an I2C1 master event (start, byte, ack, stop) is completed
+ */
+void __attribute__((__interrupt__, auto_psv )) _ISR _MI2C1Interrupt (void)
+{
+    I2C1_IF = 0;
+    psp_i2c_async_handler(HW_I2C1);
+}
+#endif
+
+#if I2C2_BAUD != 0 && I2C2_SW == 0 && I2C2_PRIO != HW_INT_PRIO_OFF
+/**
+ * Called when an I2C2 master event (start, byte, ack, stop) is completed
+ */
+void __attribute__((__interrupt__, auto_psv )) _ISR _MI2C2Interrupt (void)
+{
+    I2C2_IF = 0;
+    psp_i2c_async_handler(HW_I2C2);
+}
+#endif
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -233,10 +446,241 @@ static hw_res_t psp_i2c_idle(i2c_t id)
     if(res == HW_RES_OK) {
         while(m_dsc[id].I2CxCON->SEN || m_dsc[id].I2CxCON->RSEN || 
               m_dsc[id].I2CxCON->PEN || m_dsc[id].I2CxCON->RCEN || 
-              m_dsc[id].I2CxCON->ACKEN);
+              m_dsc[id].I2CxCON->ACKEN) {
+            if(psp_i2c_tout(id) != false) {
+                res = HW_RES_TOUT;
+                break;
+            }
+        }
     }
     
     return res;
 }
 
+/**
+ * Check the timeout of the current transfer and call the yield function while waiting
+ * @param id id of an i2c (from i2c_t)
+ * @return true: the timeout is elapsed
+ */
+static bool psp_i2c_tout(i2c_t id)
+{
+#if USE_TICK != 0
+    if(m_dsc[id].tout != UINT32_MAX && 
+       tick_elaps(m_dsc[id].tout_start) >= m_dsc[id].tout) {
+        return true;
+    }
+    
+    tick_yield();
+#endif
+    
+    return false;
+}
+
+/**
+ * Start the next queued transaction (if any).
+ * Call it only when the bus is free and with disabled interrupt.
+ * @param id id of an i2c (from i2c_t)
+ */
+static void psp_i2c_async_next(i2c_t id)
+{
+    m_dsc_t * dsc = &m_dsc[id];
+    
+    if(dsc->head == NULL) {
+        dsc->state = PSP_I2C_ST_IDLE;
+        return;
+    }
+    
+    dsc->idx = 0;
+    dsc->res = HW_RES_OK;
+#if USE_TICK != 0
+    dsc->async_start = tick_get();
+#endif
+    dsc->state = PSP_I2C_ST_START;
+    dsc->I2CxCON->SEN = 1;
+}
+
+/**
+ * Continue the running transaction. Called from the master interrupt.
+ * @param id id of an i2c (from i2c_t)
+ */
+static void psp_i2c_async_handler(i2c_t id)
+{
+    m_dsc_t * dsc = &m_dsc[id];
+    i2c_trans_t * t = dsc->head;
+    
+    /*Interrupt of a blocking transfer*/
+    if(dsc->state == PSP_I2C_ST_IDLE) return;
+    
+    /*Bus collision: the bus is lost, no stop condition is possible*/
+    if(dsc->I2CxSTAT->BCL != 0) {
+        dsc->I2CxSTAT->BCL = 0;
+        dsc->res = HW_RES_NOT_RDY;
+        dsc->state = PSP_I2C_ST_STOP;
+    }
+    
+    switch(dsc->state) {
+        case PSP_I2C_ST_START:
+            if(t->wr_len != 0) {
+                *dsc->I2CxTRN = (t->adr << 1) & 0xFE;
+                dsc->state = PSP_I2C_ST_WR;
+            } else {
+                *dsc->I2CxTRN = (t->adr << 1) | 0x01;
+                dsc->state = PSP_I2C_ST_ADR_RD;
+            }
+            break;
+            
+        case PSP_I2C_ST_WR:
+            if(dsc->I2CxSTAT->ACKSTAT != 0) {
+                psp_i2c_async_stop(id, HW_RES_NO_ACK);
+            } else if(dsc->idx < t->wr_len) {
+                *dsc->I2CxTRN = t->wr_data[dsc->idx];
+                dsc->idx++;
+            } else if(t->rd_len != 0) {
+                dsc->I2CxCON->RSEN = 1;
+                dsc->state = PSP_I2C_ST_RESTART;
+            } else {
+                psp_i2c_async_stop(id, HW_RES_OK);
+            }
+            break;
+            
+        case PSP_I2C_ST_RESTART:
+            *dsc->I2CxTRN = (t->adr << 1) | 0x01;
+            dsc->state = PSP_I2C_ST_ADR_RD;
+            break;
+            
+        case PSP_I2C_ST_ADR_RD:
+            if(dsc->I2CxSTAT->ACKSTAT != 0) {
+                psp_i2c_async_stop(id, HW_RES_NO_ACK);
+            } else {
+                dsc->idx = 0;
+                dsc->I2CxCON->RCEN = 1;
+                dsc->state = PSP_I2C_ST_RD;
+            }
+            break;
+            
+        case PSP_I2C_ST_RD:
+            t->rd_data[dsc->idx] = *dsc->I2CxRCV;
+            dsc->idx++;
+            /*ACK every byte except the last*/
+            dsc->I2CxCON->ACKDT = dsc->idx < t->rd_len ? 0 : 1;
+            dsc->I2CxCON->ACKEN = 1;
+            dsc->state = PSP_I2C_ST_ACK;
+            break;
+            
+        case PSP_I2C_ST_ACK:
+            if(dsc->idx < t->rd_len) {
+                dsc->I2CxCON->RCEN = 1;
+                dsc->state = PSP_I2C_ST_RD;
+            } else {
+                psp_i2c_async_stop(id, HW_RES_OK);
+            }
+            break;
+            
+        case PSP_I2C_ST_STOP:
+            /*Ready. Remove from the queue before the callback to let it queue again*/
+            dsc->head = t->next;
+            dsc->state = PSP_I2C_ST_IDLE;
+            if(t->cb != NULL) t->cb(t, dsc->res);
+            
+            if(dsc->state == PSP_I2C_ST_IDLE && dsc->sync_act == false) {
+                psp_i2c_async_next(id);
+            }
+            break;
+            
+        default:
+            break;
+    }
+}
+
+/**
+ * Finish the running transaction with a stop condition
+ * @param id id of an i2c (from i2c_t)
+ * @param res result of the transaction
+ */
+static void psp_i2c_async_stop(i2c_t id, hw_res_t res)
+{
+    m_dsc[id].res = res;
+    m_dsc[id].I2CxCON->PEN = 1;
+    m_dsc[id].state = PSP_I2C_ST_STOP;
+}
+
+#if PSP_I2C_ASYNC_DL != 0
+/**
+ * Abort the running asynchronous transaction if it is longer then I2C_ASYNC_TOUT
+ * (e.g. a slave stretches the clock or the interrupt is missing).
+ * The module is reset and the callback gets HW_RES_TOUT. 
+ * A stuck bus is recovered by the next blocking transfer (see 'i2c_xfer').
+ * Called periodically from the tick.
+ * @param ctx the id of the bus (i2c_t)
+ */
+static void psp_i2c_async_dl(void * ctx)
+{
+    i2c_t id = (i2c_t)(uintptr_t) ctx;
+    m_dsc_t * dsc = &m_dsc[id];
+    i2c_trans_t * t;
+    
+    psp_i2c_int_en(id, false);
+    if(dsc->state != PSP_I2C_ST_IDLE && tick_elaps(dsc->async_start) >= I2C_ASYNC_TOUT) {
+        psp_i2c_en(id, false);
+        psp_i2c_en(id, true);
+        psp_i2c_int_clr(id);
+        
+        t = dsc->head;
+        dsc->head = t->next;
+        dsc->state = PSP_I2C_ST_IDLE;
+        if(t->cb != NULL) t->cb(t, HW_RES_TOUT);
+        
+        if(dsc->state == PSP_I2C_ST_IDLE && dsc->sync_act == false) {
+            psp_i2c_async_next(id);
+        }
+    }
+    psp_i2c_int_en(id, true);
+}
+#endif
+
+/**
+ * Enable or disable the master interrupt
+ * @param id id of an i2c (from i2c_t)
+ * @param en true: enable, false: disable
+ */
+static void psp_i2c_int_en(i2c_t id, bool en)
+{
+    switch(id) {
+#if I2C1_BAUD != 0 && I2C1_SW == 0 && I2C1_PRIO != HW_INT_PRIO_OFF
+        case HW_I2C1:
+            I2C1_IE = en ? 1 : 0;
+            break;
+#endif
+#if I2C2_BAUD != 0 && I2C2_SW == 0 && I2C2_PRIO != HW_INT_PRIO_OFF
+        case HW_I2C2:
+            I2C2_IE = en ? 1 : 0;
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+/**
+ * Clear the pending master interrupt
+ * @param id id of an i2c (from i2c_t)
+ */
+static void psp_i2c_int_clr(i2c_t id)
+{
+    switch(id) {
+#if I2C1_BAUD != 0 && I2C1_SW == 0 && I2C1_PRIO != HW_INT_PRIO_OFF
+        case HW_I2C1:
+            I2C1_IF = 0;
+            break;
+#endif
+#if I2C2_BAUD != 0 && I2C2_SW == 0 && I2C2_PRIO != HW_INT_PRIO_OFF
+        case HW_I2C2:
+            I2C2_IF = 0;
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
 #endif
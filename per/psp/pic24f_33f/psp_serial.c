@@ -13,6 +13,7 @@
 #include "hw/hw.h"
 #include "misc/mem/fifo.h"
 #include "hw/per/tick.h"
+#include "hw/per/io.h"
 #include "../psp_serial.h"
 
 /***********************
@@ -55,6 +56,65 @@
  * Usage: #if SERIAL_MODULE_EN(2) ... #endif */
 #define SERIAL_MODULE_EN(x) (SERIAL ## x ##_BUF_SIZE != 0 && SERIAL ## x ##_PRIO != HW_INT_PRIO_OFF)
 
+/*Software driven RTS pins (IO_PORTX: use the UxRTS pin of the module)*/
+#ifndef SERIAL1_RTS_PORT
+#define SERIAL1_RTS_PORT IO_PORTX
+#define SERIAL1_RTS_PIN  IO_PINX
+#endif
+#ifndef SERIAL2_RTS_PORT
+#define SERIAL2_RTS_PORT IO_PORTX
+#define SERIAL2_RTS_PIN  IO_PINX
+#endif
+#ifndef SERIAL3_RTS_PORT
+#define SERIAL3_RTS_PORT IO_PORTX
+#define SERIAL3_RTS_PIN  IO_PINX
+#endif
+#ifndef SERIAL4_RTS_PORT
+#define SERIAL4_RTS_PORT IO_PORTX
+#define SERIAL4_RTS_PIN  IO_PINX
+#endif
+
+/*Release the software RTS if less then this many bytes are free in the rx FIFO.
+ *It is asserted again when the double of it is free*/
+#ifndef SERIAL_RTS_WATERMARK
+#define SERIAL_RTS_WATERMARK    8
+#endif
+
+/*RS-485 driver enable pins (IO_PORTX: RS-485 mode is not possible)*/
+#ifndef SERIAL1_DE_PORT
+#define SERIAL1_DE_PORT IO_PORTX
+#define SERIAL1_DE_PIN  IO_PINX
+#endif
+#ifndef SERIAL2_DE_PORT
+#define SERIAL2_DE_PORT IO_PORTX
+#define SERIAL2_DE_PIN  IO_PINX
+#endif
+#ifndef SERIAL3_DE_PORT
+#define SERIAL3_DE_PORT IO_PORTX
+#define SERIAL3_DE_PIN  IO_PINX
+#endif
+#ifndef SERIAL4_DE_PORT
+#define SERIAL4_DE_PORT IO_PORTX
+#define SERIAL4_DE_PIN  IO_PINX
+#endif
+
+/*Keep the driver enabled this long before the first start bit 
+ * and after the last stop bit [us]*/
+#ifndef SERIAL_RS485_GUARD_US
+#define SERIAL_RS485_GUARD_US   0
+#endif
+
+#define SERIAL_RTS_READY    0   /*RTS is active low*/
+#define SERIAL_RTS_BUSY     1
+
+#define SERIAL_DE_ON        1   /*DE is active high (RE is active low, it can be wired together)*/
+#define SERIAL_DE_OFF       0
+
+/*RX interrupt when 3 bytes are in the UART's 4 level FIFO (the rest is read by 'psp_serial_rd')*/
+#ifndef SERIAL_URXISEL
+#define SERIAL_URXISEL  0b10
+#endif
+
 /***********************
  *       TYPEDEFS
  ***********************/
@@ -87,8 +147,14 @@ typedef struct
     volatile unsigned int * rx_reg;
     uint32_t buf_size;
     uint8_t mode;
+    io_port_t rts_port;
+    io_pin_t rts_pin;
+    io_port_t de_port;
+    io_pin_t de_pin;
     fifo_t tx_fifo;
     fifo_t rx_fifo;
+    volatile bool rx_stop;  /*The rx FIFO was full, the bytes are left in the UART*/
+    volatile bool de_on;    /*RS-485 driver is enabled*/
 }m_dsc_t;
 
 /***********************
@@ -120,26 +186,26 @@ static uint8_t rbuf4[SERIAL4_BUF_SIZE];
 
 static m_dsc_t m_dsc[] = 
 {
-    /*UxMODE                 UxSTA                 UxBRG   UxTXREG    U1RXREG   buf_size               mode */
+    /*UxMODE                 UxSTA                 UxBRG   UxTXREG    U1RXREG   buf_size               mode    rts_port    rts_pin    de_port    de_pin */
 #if SERIAL_MODULE_EN(1)
-    {(U1MODEBITS *) &U1MODE, (MY_U1STABITS *) &U1STA, &U1BRG, &U1TXREG,  &U1RXREG, SERIAL1_BUF_SIZE, SERIAL1_MODE},
+    {(U1MODEBITS *) &U1MODE, (MY_U1STABITS *) &U1STA, &U1BRG, &U1TXREG,  &U1RXREG, SERIAL1_BUF_SIZE, SERIAL1_MODE, SERIAL1_RTS_PORT, SERIAL1_RTS_PIN, SERIAL1_DE_PORT, SERIAL1_DE_PIN},
 #else
-    {NULL,                 NULL,                   NULL,   NULL,      NULL,     0,                       0},
+    {NULL,                 NULL,                   NULL,   NULL,      NULL,     0,                       0,      IO_PORTX,   IO_PINX,   IO_PORTX,  IO_PINX},
 #endif          
 #if SERIAL_MODULE_EN(2)
-    {(U1MODEBITS *) &U2MODE, (MY_U1STABITS *) &U2STA, &U2BRG, &U2TXREG,  &U2RXREG, SERIAL2_BUF_SIZE, SERIAL2_MODE},
+    {(U1MODEBITS *) &U2MODE, (MY_U1STABITS *) &U2STA, &U2BRG, &U2TXREG,  &U2RXREG, SERIAL2_BUF_SIZE, SERIAL2_MODE, SERIAL2_RTS_PORT, SERIAL2_RTS_PIN, SERIAL2_DE_PORT, SERIAL2_DE_PIN},
 #else
-    {NULL,                 NULL,                   NULL,   NULL,      NULL,     0,                       0},
+    {NULL,                 NULL,                   NULL,   NULL,      NULL,     0,                       0,      IO_PORTX,   IO_PINX,   IO_PORTX,  IO_PINX},
 #endif        
 #if SERIAL_MODULE_EN(3)
-    {(U1MODEBITS *) &U3MODE, (MY_U1STABITS *) &U3STA, &U3BRG, &U3TXREG,  &U3RXREG, SERIAL3_BUF_SIZE, SERIAL3_MODE},
+    {(U1MODEBITS *) &U3MODE, (MY_U1STABITS *) &U3STA, &U3BRG, &U3TXREG,  &U3RXREG, SERIAL3_BUF_SIZE, SERIAL3_MODE, SERIAL3_RTS_PORT, SERIAL3_RTS_PIN, SERIAL3_DE_PORT, SERIAL3_DE_PIN},
 #else
-    {NULL,                 NULL,                   NULL,   NULL,      NULL,     0,                       0},
+    {NULL,                 NULL,                   NULL,   NULL,      NULL,     0,                       0,      IO_PORTX,   IO_PINX,   IO_PORTX,  IO_PINX},
 #endif        
 #if SERIAL_MODULE_EN(4)
-    {(U1MODEBITS *) &U4MODE, (MY_U1STABITS *) &U4STA, &U4BRG, &U4TXREG,  &U4RXREG, SERIAL4_BUF_SIZE, SERIAL4_MODE},},
+    {(U1MODEBITS *) &U4MODE, (MY_U1STABITS *) &U4STA, &U4BRG, &U4TXREG,  &U4RXREG, SERIAL4_BUF_SIZE, SERIAL4_MODE, SERIAL4_RTS_PORT, SERIAL4_RTS_PIN, SERIAL4_DE_PORT, SERIAL4_DE_PIN},
 #else
-    {NULL,                 NULL,                   NULL,   NULL,      NULL,     0,                       0},
+    {NULL,                 NULL,                   NULL,   NULL,      NULL,     0,                       0,      IO_PORTX,   IO_PINX,   IO_PORTX,  IO_PINX},
 #endif
 };
 
@@ -153,8 +219,13 @@ static m_dsc_t m_dsc[] =
  ***********************/
 static void psp_serial_init_irq(void);
 static void psp_serial_init_module(void);
+static uint8_t psp_serial_get_uen(serial_t id);
 static void psp_serial_send_next(serial_t id);
-static void psp_serial_rec_next(serial_t modul_id);
+static bool psp_serial_rec_next(serial_t modul_id);
+static void psp_serial_rx_resume(serial_t id);
+static void psp_serial_rts_update(serial_t id);
+static void psp_serial_de_on(serial_t id);
+static void psp_serial_de_off(serial_t id);
 static void psp_serial_rx_int_en(serial_t id, uint8_t state);
 static void psp_serial_tx_int_en(serial_t id, uint8_t state);
 
@@ -189,8 +260,14 @@ hw_res_t psp_serial_wr(serial_t id, uint8_t tx)
         /*The fifo is used in the interrupt so disable interrupts*/
         psp_serial_tx_int_en(id, 0); 
         fifo_ret = fifo_push(&m_dsc[id].tx_fifo, &tx); 
-        /* If data is added to the fifo start sending*/
-        if(fifo_ret != false && m_dsc[id].UxSTA->TRMT != 0) {
+        
+        /*RS-485: take the bus before the first byte*/
+        if(fifo_ret != false && (m_dsc[id].mode & SERIAL_MODE_RS485)) {
+            psp_serial_de_on(id);
+        }
+        
+        /* If data is added to the fifo and the UART has free space start sending*/
+        if(fifo_ret != false && m_dsc[id].UxSTA->UTXBF == 0) {
             psp_serial_send_next(id);
         }
         
@@ -228,7 +305,13 @@ hw_res_t psp_serial_rd(serial_t id, uint8_t * rx)
     /*The fifo is used in the interrupt so disable interrupts*/
     psp_serial_rx_int_en(id, 0); 
     fifo_ret = fifo_pop(&m_dsc[id].rx_fifo, rx); 
-    psp_serial_rx_int_en(id, 1); 
+    
+    /*The last bytes can wait in the UART below the interrupt threshold*/
+    if(fifo_ret == false) {
+        while(m_dsc[id].UxSTA->URXDA != 0 && psp_serial_rec_next(id) != false);
+        fifo_ret = fifo_pop(&m_dsc[id].rx_fifo, rx); 
+    }
+    psp_serial_rx_resume(id);
 
     if(fifo_ret == false)  return HW_RES_EMPTY;
     
@@ -248,7 +331,8 @@ hw_res_t psp_serial_set_baud(serial_t id, uint32_t baud)
     
     /*If a register is NULL then the module is disabled*/
     if(m_dsc[id].UxMODE != NULL) {
-        uint32_t brg = ((uint32_t) CLOCK_PERIPH / baud / 4) - 1;
+        /*Round to the nearest divider else the error is too high on high baud rates*/
+        uint32_t brg = (((uint32_t) CLOCK_PERIPH + 2 * baud) / (4 * baud)) - 1;
         m_dsc[id].UxMODE->BRGH = 1;
         *m_dsc[id].UxBRG = brg;
     } else {
@@ -267,7 +351,9 @@ hw_res_t psp_serial_clear_rx_buf(serial_t id)
 {
     hw_res_t res = HW_RES_OK;
     if(m_dsc[id].UxMODE != NULL) {
+        psp_serial_rx_int_en(id, 0); 
         fifo_clear(&m_dsc[id].rx_fifo);
+        psp_serial_rx_resume(id);
     } else {
         res = HW_RES_DIS;
     }
@@ -292,7 +378,7 @@ void __attribute__((__interrupt__, auto_psv )) _ISR _U1TXInterrupt (void)
 void __attribute__((__interrupt__, auto_psv )) _ISR _U1RXInterrupt (void)
 {
     SERIAL1_RX_IF = 0;
-    while(U1STAbits.URXDA)  psp_serial_rec_next(HW_SERIAL1);
+    while(U1STAbits.URXDA && psp_serial_rec_next(HW_SERIAL1));
 }
 #endif
 
@@ -314,7 +400,7 @@ void __attribute__((__interrupt__, auto_psv )) _ISR _U2TXInterrupt (void)
 void __attribute__((__interrupt__, auto_psv )) _ISR _U2RXInterrupt (void)
 {
     SERIAL2_RX_IF = 0;
-    while(U2STAbits.URXDA) psp_serial_rec_next(HW_SERIAL2);
+    while(U2STAbits.URXDA && psp_serial_rec_next(HW_SERIAL2));
 }
 #endif
 
@@ -335,7 +421,7 @@ void __attribute__((__interrupt__, auto_psv )) _ISR _U3TXInterrupt (void)
 void __attribute__((__interrupt__, auto_psv )) _ISR _U3RXInterrupt (void)
 {
     SERIAL3_RX_IF = 0;
-    while(U3STAbits.URXDA) psp_serial_rec_next(HW_SERIAL3);
+    while(U3STAbits.URXDA && psp_serial_rec_next(HW_SERIAL3));
 }
 #endif
 
@@ -356,7 +442,7 @@ void __attribute__((__interrupt__, auto_psv )) _ISR _U4TXInterrupt (void)
 void __attribute__((__interrupt__, auto_psv )) _ISR _U4RXInterrupt (void)
 {
     SERIAL4_RX_IF = 0;
-    while(U4STAbits.URXDA)  psp_serial_rec_next(HW_SERIAL4);
+    while(U4STAbits.URXDA && psp_serial_rec_next(HW_SERIAL4));
 }
 #endif
 
@@ -443,10 +529,26 @@ static void psp_serial_init_module(void)
             /*Init the modules*/
             psp_serial_set_baud(id, SERIAL_DEF_BAUD);
 
-            m_dsc[id].UxMODE->UEN = 0b00; /*00 = SERIAL: UxTX, UxRX, I/O: UxCTS, UxRTS */
+            m_dsc[id].UxMODE->UEN = psp_serial_get_uen(id);
+            m_dsc[id].UxMODE->RTSMD = 0;   /*UxRTS in flow control mode*/
+            if(m_dsc[id].rts_port != IO_PORTX) {
+                io_set_pin_dir(m_dsc[id].rts_port, m_dsc[id].rts_pin, IO_DIR_OUT);
+                io_set_pin(m_dsc[id].rts_port, m_dsc[id].rts_pin, SERIAL_RTS_READY);
+            }
+            
+            /*RS-485 needs a DE pin. Start in receive mode*/
+            m_dsc[id].de_on = false;
+            if(m_dsc[id].de_port == IO_PORTX) {
+                m_dsc[id].mode &= ~SERIAL_MODE_RS485;
+            } else if(m_dsc[id].mode & SERIAL_MODE_RS485) {
+                io_set_pin_dir(m_dsc[id].de_port, m_dsc[id].de_pin, IO_DIR_OUT);
+                io_set_pin(m_dsc[id].de_port, m_dsc[id].de_pin, SERIAL_DE_OFF);
+            }
             m_dsc[id].UxMODE->UARTEN = 1;    /*SERIALx is enable*/
-            m_dsc[id].UxSTA->UTXISEL0 = 1;
-            m_dsc[id].UxSTA->UTXISEL1 = 0;
+            /*10 = TX interrupt when the UART's FIFO becomes empty*/
+            m_dsc[id].UxSTA->UTXISEL0 = 0;
+            m_dsc[id].UxSTA->UTXISEL1 = 1;
+            m_dsc[id].UxSTA->URXISEL = SERIAL_URXISEL;
             m_dsc[id].UxSTA->UTXEN = 1;   /*SERIALx TX int. enable*/
             m_dsc[id].UxSTA->URXEN = 1;   /*SERIALx RX int. enable*/
         }
@@ -455,27 +557,80 @@ static void psp_serial_init_module(void)
 }
 
 /**
- * Send the next byte from tx FIFO
+ * Move bytes from the tx FIFO to the UART until its hardware FIFO is full
  * @param id the id of the UART module (from serial_t enum)
  */
 static void psp_serial_send_next(serial_t id)
 {
-    
-    //pop the data from the buffer and send it
     uint8_t tx_byte;
-    if(fifo_pop(&m_dsc[id].tx_fifo, &tx_byte) != false) {
+    bool fifo_empty = false;
+    
+    while(m_dsc[id].UxSTA->UTXBF == 0) {
+        if(fifo_pop(&m_dsc[id].tx_fifo, &tx_byte) == false) {
+            fifo_empty = true;
+            break;
+        }
         *m_dsc[id].tx_reg = tx_byte;
     }
+    
+    if(m_dsc[id].de_on == false) return;
+    
+    if(fifo_empty == false) {
+        /*10 = TX interrupt when the UART's FIFO becomes empty*/
+        m_dsc[id].UxSTA->UTXISEL0 = 0;
+        m_dsc[id].UxSTA->UTXISEL1 = 1;
+        return;
+    }
+    
+    /*RS-485: release the driver exactly when the last stop bit is shifted out.
+     *01 = TX interrupt when the shift register becomes empty too. 
+     *Check TRMT after the change because the edge could be missed*/
+    m_dsc[id].UxSTA->UTXISEL0 = 1;
+    m_dsc[id].UxSTA->UTXISEL1 = 0;
+    if(m_dsc[id].UxSTA->TRMT == 0) return;   /*Wait for the interrupt*/
+    
+    psp_serial_de_off(id);
+    m_dsc[id].UxSTA->UTXISEL0 = 0;
+    m_dsc[id].UxSTA->UTXISEL1 = 1;
+}
+
+/**
+ * Get the UEN bits (pin usage) of a module according to its mode
+ * @param id the id of the UART module (from serial_t enum)
+ * @return the value for UxMODE.UEN
+ */
+static uint8_t psp_serial_get_uen(serial_t id)
+{
+    uint8_t mode = m_dsc[id].mode;
+    
+    /*10 = UxTX, UxRX, UxCTS, UxRTS (UxRTS is unused with a software RTS pin)*/
+    if(mode & SERIAL_MODE_CTS_EN) return 0b10;
+    
+    /*01 = UxTX, UxRX, UxRTS; I/O: UxCTS */
+    if((mode & SERIAL_MODE_RTS_EN) && m_dsc[id].rts_port == IO_PORTX) return 0b01;
+    
+    /*00 = UxTX, UxRX; I/O: UxCTS, UxRTS */
+    return 0b00;
 }
 
 /**
  * Read the UART module and push the read byte into the rx FIFO
  * @param id the id of the UART module (from serial_t enum)
+ * @return true: a byte is read, false: the rx FIFO is full and with flow control 
+ *         the bytes are left in the UART (the rx interrupt is disabled)
  */
-static void psp_serial_rec_next(serial_t id)
+static bool psp_serial_rec_next(serial_t id)
 {
     m_dsc_t * dsc = &m_dsc[id];
     
+    /*With flow control do not drop the byte. Let the UART FIFO fill up
+     *to make the hardware RTS stop the sender*/
+    if((dsc->mode & SERIAL_MODE_RTS_EN) && fifo_get_free(&dsc->rx_fifo) == 0) {
+        dsc->rx_stop = true;
+        psp_serial_rx_int_en(id, 0);
+        return false;
+    }
+    
     uint8_t rec_data = *(dsc->rx_reg);
     
     if(m_dsc[id].UxSTA->OERR != 0) m_dsc[id].UxSTA->OERR = 0;
@@ -484,6 +639,76 @@ static void psp_serial_rec_next(serial_t id)
     if(fifo_get_free(&dsc->rx_fifo) != 0){
         fifo_push(&dsc->rx_fifo, &rec_data);
     }
+    
+    psp_serial_rts_update(id);
+    
+    return true;
+}
+
+/**
+ * Continue the receiving after bytes are removed from the rx FIFO.
+ * Read the bytes waiting in the UART (if stopped), update RTS and enable the rx interrupt.
+ * The rx interrupt has to be disabled before calling this function.
+ * @param id the id of the UART module (from serial_t enum)
+ */
+static void psp_serial_rx_resume(serial_t id)
+{
+    if(m_dsc[id].rx_stop != false) {
+        m_dsc[id].rx_stop = false;
+        while(m_dsc[id].UxSTA->URXDA != 0 && psp_serial_rec_next(id) != false);
+    }
+    
+    psp_serial_rts_update(id);
+    
+    /*Keep the interrupt disabled if the rx FIFO is still full*/
+    if(m_dsc[id].rx_stop == false) psp_serial_rx_int_en(id, 1); 
+}
+
+/**
+ * Drive the software RTS pin according to the free space in the rx FIFO
+ * @param id the id of the UART module (from serial_t enum)
+ */
+static void psp_serial_rts_update(serial_t id)
+{
+    m_dsc_t * dsc = &m_dsc[id];
+    
+    if(dsc->rts_port == IO_PORTX) return;
+    if((dsc->mode & SERIAL_MODE_RTS_EN) == 0) return;
+    
+    uint32_t free = fifo_get_free(&dsc->rx_fifo);
+    if(free < SERIAL_RTS_WATERMARK) {
+        io_set_pin(dsc->rts_port, dsc->rts_pin, SERIAL_RTS_BUSY);
+    } else if(free >= 2 * SERIAL_RTS_WATERMARK) {
+        io_set_pin(dsc->rts_port, dsc->rts_pin, SERIAL_RTS_READY);
+    }
+}
+
+/**
+ * Enable the RS-485 driver (if not enabled yet)
+ * @param id the id of the UART module (from serial_t enum)
+ */
+static void psp_serial_de_on(serial_t id)
+{
+    if(m_dsc[id].de_on != false) return;
+    
+    io_set_pin(m_dsc[id].de_port, m_dsc[id].de_pin, SERIAL_DE_ON);
+    m_dsc[id].de_on = true;
+#if SERIAL_RS485_GUARD_US != 0
+    tick_wait_us(SERIAL_RS485_GUARD_US);
+#endif
+}
+
+/**
+ * Release the RS-485 driver. Call it only when the shift register is empty (TRMT)
+ * @param id the id of the UART module (from serial_t enum)
+ */
+static void psp_serial_de_off(serial_t id)
+{
+#if SERIAL_RS485_GUARD_US != 0
+    tick_wait_us(SERIAL_RS485_GUARD_US);
+#endif
+    io_set_pin(m_dsc[id].de_port, m_dsc[id].de_pin, SERIAL_DE_OFF);
+    m_dsc[id].de_on = false;
 }
 
 /**
@@ -104,6 +104,7 @@ static const uint16_t tmr_ps[] = {1, 8, 64, 256};
  *   STATIC PROTOTYPES
  ***********************/
 static bool psp_tmr_id_test(tmr_t id);
+static bool psp_tmr_get_if(tmr_t tmr);
 
 /***********************
  *   GLOBAL FUNCTIONS
@@ -153,6 +154,7 @@ hw_res_t psp_tmr_set_period(tmr_t tmr, uint32_t p_us)
             /*Set the prescale*/
             *m_dsc[tmr].PRx = new_pr;
             m_dsc[tmr].TxCON->TCKPS = i-1;
+            m_dsc[tmr].period = p_us;
 
             /*Set the clock source*/
             m_dsc[tmr].TxCON->TCS = 0;
@@ -197,6 +199,30 @@ void psp_tmr_run(tmr_t tmr, bool en)
     m_dsc[tmr].TxCON->TON = (en == false ? 0 : 1);
 }
 
+/**
+ * Get the elapsed time in the current period of a timer
+ * @param tmr the id of a timer (HW_TMRx)
+ * @return microseconds since the last period end. More than the period
+ *         if the interrupt of the last period is not handled yet.
+ */
+uint32_t psp_tmr_get_us(tmr_t tmr)
+{
+    if(psp_tmr_id_test(tmr) == false) return 0;
+
+    uint32_t us = 0;
+    uint32_t cnt = *m_dsc[tmr].TMRx;
+
+    /*Overflowed but not handled? Read again because the counter might have overflowed after the first read*/
+    if(psp_tmr_get_if(tmr) != false) {
+        cnt = *m_dsc[tmr].TMRx;
+        us = m_dsc[tmr].period;
+    }
+
+    us += ((uint64_t) cnt * m_dsc[tmr].period) / ((uint64_t) *m_dsc[tmr].PRx + 1);
+
+    return us;
+}
+
 /**
  * Enable/disable the timer interrupt
  * @param tmr id of the timer (from tmr_t enum)
@@ -256,6 +282,70 @@ void psp_tmr_en_int(tmr_t tmr, bool en)
     }
 }
 
+/**
+ * PWM is not implemented on PIC24F/dsPIC33F (the output compare modules differ in the families)
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param tmr the id of a timer (HW_TMRx)
+ * @return HW_RES_DIS
+ */
+hw_res_t psp_tmr_pwm_init(tmr_ch_t ch, tmr_t tmr)
+{
+    (void) ch;
+    (void) tmr;
+
+    return HW_RES_DIS;
+}
+
+/**
+ * PWM is not implemented on PIC24F/dsPIC33F
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param duty high time in 1/65536 of the period
+ * @return HW_RES_DIS
+ */
+hw_res_t psp_tmr_pwm_set(tmr_ch_t ch, uint16_t duty)
+{
+    (void) ch;
+    (void) duty;
+
+    return HW_RES_DIS;
+}
+
+/**
+ * PWM is not implemented on PIC24F/dsPIC33F
+ * @param ch the id of a channel (HW_TMR_CHx)
+ */
+void psp_tmr_pwm_stop(tmr_ch_t ch)
+{
+    (void) ch;
+}
+
+/**
+ * Input capture is not implemented on PIC24F/dsPIC33F
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param tmr the id of a timer (HW_TMRx)
+ * @param edge the edges to capture
+ * @param cb called with the time of every edge
+ * @return HW_RES_DIS
+ */
+hw_res_t psp_tmr_ic_init(tmr_ch_t ch, tmr_t tmr, tmr_ic_edge_t edge, tmr_ic_cb_t cb)
+{
+    (void) ch;
+    (void) tmr;
+    (void) edge;
+    (void) cb;
+
+    return HW_RES_DIS;
+}
+
+/**
+ * Input capture is not implemented on PIC24F/dsPIC33F
+ * @param ch the id of a channel (HW_TMR_CHx)
+ */
+void psp_tmr_ic_stop(tmr_ch_t ch)
+{
+    (void) ch;
+}
+
 /**
  * Timer 1 interrupt handler
  */
@@ -362,4 +452,42 @@ static bool psp_tmr_id_test(tmr_t id)
 }
 
 
+/**
+ * Get the interrupt flag of a timer
+ * @param tmr the id of a timer (HW_TMRx)
+ * @return true: the interrupt flag is set
+ */
+static bool psp_tmr_get_if(tmr_t tmr)
+{
+    switch(tmr)
+    {
+#if TMR1_EN != 0
+        case HW_TMR1:
+            return TIMER1_IF != 0 ? true : false;
+#endif
+#if TMR2_EN != 0
+        case HW_TMR2:
+            return TIMER2_IF != 0 ? true : false;
+#endif
+#if TMR3_EN != 0
+        case HW_TMR3:
+            return TIMER3_IF != 0 ? true : false;
+#endif
+#if TMR4_EN != 0
+        case HW_TMR4:
+            return TIMER4_IF != 0 ? true : false;
+#endif
+#if TMR5_EN != 0
+        case HW_TMR5:
+            return TIMER5_IF != 0 ? true : false;
+#endif
+#if TMR6_EN != 0
+        case HW_TMR6:
+            return TIMER6_IF != 0 ? true : false;
+#endif
+        default:
+            return false;
+    }
+}
+
 #endif
@@ -49,6 +49,16 @@ void psp_par_set_wait_time(uint8_t wait)
 }
 
 
+void psp_par_wr(uint32_t adr, uint16_t data)
+{
+    
+}
+
+uint16_t psp_par_rd(uint32_t adr)
+{
+    return 0;
+}
+
 void psp_par_wr_array(uint32_t adr, const void * buf, uint32_t length)
 {
     
@@ -59,6 +69,21 @@ void psp_par_rd_array(uint32_t adr, void * buf, uint32_t length)
     
 }
 
+void psp_par_fill(uint32_t adr, uint16_t data, uint32_t length)
+{
+    
+}
+
+hw_res_t psp_par_wr_array_async(uint32_t adr, const void * buf, uint32_t length, par_cb_t cb)
+{
+    return HW_RES_DIS;
+}
+
+bool psp_par_busy(void)
+{
+    return false;
+}
+
 
 /**********************
  *   STATIC FUNCTIONS
@@ -45,6 +45,35 @@
 #define TIMER5_IE IEC0bits.T5IE
 #define TIMER5_IP IPC5bits.T5IP
 
+#ifndef TMR_IC_PRIO
+#define TMR_IC_PRIO     HW_INT_PRIO_OFF
+#endif
+
+#define OC_MODE_PWM     0x6     /*PWM mode without fault pin*/
+#define IC_MODE_RISE    0x3     /*Every rising edge*/
+#define IC_MODE_FALL    0x2     /*Every falling edge*/
+#define IC_MODE_BOTH    0x1     /*Every edge*/
+
+#define IC1_IF IFS0bits.IC1IF
+#define IC1_IE IEC0bits.IC1IE
+#define IC1_IP IPC1bits.IC1IP
+
+#define IC2_IF IFS0bits.IC2IF
+#define IC2_IE IEC0bits.IC2IE
+#define IC2_IP IPC2bits.IC2IP
+
+#define IC3_IF IFS0bits.IC3IF
+#define IC3_IE IEC0bits.IC3IE
+#define IC3_IP IPC3bits.IC3IP
+
+#define IC4_IF IFS0bits.IC4IF
+#define IC4_IE IEC0bits.IC4IE
+#define IC4_IP IPC4bits.IC4IP
+
+#define IC5_IF IFS0bits.IC5IF
+#define IC5_IE IEC0bits.IC5IE
+#define IC5_IP IPC5bits.IC5IP
+
 #define IPL_NAME(prio) IPL_CONC(prio)
 #define IPL_CONC(prio) IPL ## prio ## AUTO
 /***********************
@@ -64,6 +93,18 @@ typedef struct
     void (*cb)(void);
 }timer_dsc_t;
 
+/*Registers and state of an output compare and input capture channel*/
+typedef struct
+{
+    volatile __OC1CONbits_t * OCxCON;
+    volatile unsigned int * OCxRS;
+    volatile __IC1CONbits_t * ICxCON;
+    volatile unsigned int * ICxBUF;
+    tmr_t oc_tmr;
+    tmr_t ic_tmr;
+    tmr_ic_cb_t ic_cb;
+}ch_dsc_t;
+
 
 /***********************
  *   STATIC VARIABLES
@@ -115,6 +156,15 @@ static timer_regs_t reg_map[] =
 };
 static const uint16_t tmr_ps[] = {1, 2, 4, 8, 16, 32, 64, 256}; 
 
+static ch_dsc_t ch_dsc[HW_TMR_CH_NUM] =
+{           /*OCxCON*/                              /*OCxRS*/  /*ICxCON*/                              /*ICxBUF*/  /*oc_tmr*/  /*ic_tmr*/  /*ic_cb*/
+        {(volatile __OC1CONbits_t*)&OC1CONbits,  &OC1RS,   (volatile __IC1CONbits_t*)&IC1CONbits,  &IC1BUF,   HW_TMRX,    HW_TMRX,    NULL},
+        {(volatile __OC1CONbits_t*)&OC2CONbits,  &OC2RS,   (volatile __IC1CONbits_t*)&IC2CONbits,  &IC2BUF,   HW_TMRX,    HW_TMRX,    NULL},
+        {(volatile __OC1CONbits_t*)&OC3CONbits,  &OC3RS,   (volatile __IC1CONbits_t*)&IC3CONbits,  &IC3BUF,   HW_TMRX,    HW_TMRX,    NULL},
+        {(volatile __OC1CONbits_t*)&OC4CONbits,  &OC4RS,   (volatile __IC1CONbits_t*)&IC4CONbits,  &IC4BUF,   HW_TMRX,    HW_TMRX,    NULL},
+        {(volatile __OC1CONbits_t*)&OC5CONbits,  &OC5RS,   (volatile __IC1CONbits_t*)&IC5CONbits,  &IC5BUF,   HW_TMRX,    HW_TMRX,    NULL},
+};
+
 /***********************
  *   GLOBAL PROTOTYPES
  ***********************/
@@ -123,6 +173,12 @@ static const uint16_t tmr_ps[] = {1, 2, 4, 8, 16, 32, 64, 256};
  *   STATIC PROTOTYPES
  ***********************/
 static hw_res_t psp_tmr_id_test(tmr_t id);
+static bool psp_tmr_get_if(tmr_t tmr);
+static uint32_t psp_tmr_cnt_to_us(tmr_t tmr, uint32_t cnt);
+#if TMR_IC_PRIO != HW_INT_PRIO_OFF
+static void psp_tmr_ic_en_int(tmr_ch_t ch, bool en);
+static void psp_tmr_ic_isr(tmr_ch_t ch);
+#endif
 
 /***********************
  *   GLOBAL FUNCTIONS
@@ -160,6 +216,7 @@ hw_res_t psp_tmr_set_period(tmr_t tmr, uint32_t p_us)
             }
 
             reg_map[tmr].TxCON->TCKPS = i;    
+            m_dsc[tmr].period = p_us;
         }
     }
     
@@ -185,6 +242,30 @@ void psp_tmr_set_cb(tmr_t tmr, void (*cb) (void))
     }
 }
 
+/**
+ * Get the elapsed time in the current period of a timer
+ * @param tmr the id of a timer (HW_TMRx)
+ * @return microseconds since the last period end. More than the period
+ *         if the interrupt of the last period is not handled yet.
+ */
+uint32_t psp_tmr_get_us(tmr_t tmr)
+{
+    if(psp_tmr_id_test(tmr) != HW_RES_OK) return 0;
+
+    uint32_t us = 0;
+    uint32_t cnt = *reg_map[tmr].TMRx;
+
+    /*Overflowed but not handled? Read again because the counter might have overflowed after the first read*/
+    if(psp_tmr_get_if(tmr) != false) {
+        cnt = *reg_map[tmr].TMRx;
+        us = m_dsc[tmr].period;
+    }
+
+    us += psp_tmr_cnt_to_us(tmr, cnt);
+
+    return us;
+}
+
 void psp_tmr_en_int(tmr_t tmr, bool en)
 {
     uint8_t en_value = (en == false ?  0 : 1);
@@ -246,6 +327,114 @@ void psp_tmr_run(tmr_t tmr, bool en)
     }
 }
 
+/**
+ * Start a PWM output on an output compare module
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param tmr the id of a timer as time base. Only HW_TMR2 and HW_TMR3 can be used.
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t psp_tmr_pwm_init(tmr_ch_t ch, tmr_t tmr)
+{
+    if(psp_tmr_id_test(tmr) != HW_RES_OK) return HW_RES_NOT_EX;
+    if(tmr != HW_TMR2 && tmr != HW_TMR3) return HW_RES_INV_PARAM;
+
+    ch_dsc_t * dsc = &ch_dsc[ch];
+
+    dsc->OCxCON->ON = 0;
+    dsc->OCxCON->OC32 = 0;
+    dsc->OCxCON->OCTSEL = (tmr == HW_TMR3 ? 1 : 0);
+    *dsc->OCxRS = 0;
+    dsc->OCxCON->OCM = OC_MODE_PWM;
+    dsc->oc_tmr = tmr;
+    dsc->OCxCON->ON = 1;
+
+    return HW_RES_OK;
+}
+
+/**
+ * Set the duty cycle of a PWM output. OCxRS is loaded at the next period.
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param duty high time in 1/65536 of the period
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t psp_tmr_pwm_set(tmr_ch_t ch, uint16_t duty)
+{
+    ch_dsc_t * dsc = &ch_dsc[ch];
+
+    if(dsc->oc_tmr == HW_TMRX) return HW_RES_NOT_RDY;
+
+    *dsc->OCxRS = (((uint32_t) *reg_map[dsc->oc_tmr].PRx + 1) * duty) >> 16;
+
+    return HW_RES_OK;
+}
+
+/**
+ * Stop a PWM output
+ * @param ch the id of a channel (HW_TMR_CHx)
+ */
+void psp_tmr_pwm_stop(tmr_ch_t ch)
+{
+    ch_dsc[ch].OCxCON->ON = 0;
+    ch_dsc[ch].oc_tmr = HW_TMRX;
+}
+
+/**
+ * Start an input capture module
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param tmr the id of a timer as time base. Only HW_TMR2 and HW_TMR3 can be used.
+ * @param edge the edges to capture
+ * @param cb called with the time of every edge
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t psp_tmr_ic_init(tmr_ch_t ch, tmr_t tmr, tmr_ic_edge_t edge, tmr_ic_cb_t cb)
+{
+#if TMR_IC_PRIO != HW_INT_PRIO_OFF
+    if(psp_tmr_id_test(tmr) != HW_RES_OK) return HW_RES_NOT_EX;
+    if(tmr != HW_TMR2 && tmr != HW_TMR3) return HW_RES_INV_PARAM;
+
+    ch_dsc_t * dsc = &ch_dsc[ch];
+
+    dsc->ICxCON->ON = 0;
+    psp_tmr_ic_en_int(ch, false);
+
+    dsc->ICxCON->C32 = 0;
+    dsc->ICxCON->ICTMR = (tmr == HW_TMR2 ? 1 : 0);
+    dsc->ICxCON->ICI = 0;       /*Interrupt on every capture*/
+    if(edge == TMR_IC_RISE) dsc->ICxCON->ICM = IC_MODE_RISE;
+    else if(edge == TMR_IC_FALL) dsc->ICxCON->ICM = IC_MODE_FALL;
+    else dsc->ICxCON->ICM = IC_MODE_BOTH;
+    dsc->ic_tmr = tmr;
+    dsc->ic_cb = cb;
+
+    dsc->ICxCON->ON = 1;
+    while(dsc->ICxCON->ICBNE != 0) (void) *dsc->ICxBUF;    /*Drop the old captures*/
+    psp_tmr_ic_en_int(ch, true);
+
+    return HW_RES_OK;
+#else
+    (void) ch;
+    (void) tmr;
+    (void) edge;
+    (void) cb;
+    return HW_RES_DIS;
+#endif
+}
+
+/**
+ * Stop an input capture module
+ * @param ch the id of a channel (HW_TMR_CHx)
+ */
+void psp_tmr_ic_stop(tmr_ch_t ch)
+{
+#if TMR_IC_PRIO != HW_INT_PRIO_OFF
+    psp_tmr_ic_en_int(ch, false);
+    ch_dsc[ch].ICxCON->ON = 0;
+    ch_dsc[ch].ic_cb = NULL;
+#else
+    (void) ch;
+#endif
+}
+
 /**
  * 
  */
@@ -338,6 +527,53 @@ void __ISR(_TIMER_6_VECTOR, IPL_NAME(TMR6_PRIO)) isr_timer6 (void)
 
 #endif
 
+#if TMR_IC_PRIO != HW_INT_PRIO_OFF
+/**
+ * Input capture 1 interrupt
+ */
+void __ISR(_INPUT_CAPTURE_1_VECTOR, IPL_NAME(TMR_IC_PRIO)) isr_ic1(void)
+{
+    psp_tmr_ic_isr(HW_TMR_CH1);
+    IC1_IF = 0;
+}
+
+/**
+ * Input capture 2 interrupt
+ */
+void __ISR(_INPUT_CAPTURE_2_VECTOR, IPL_NAME(TMR_IC_PRIO)) isr_ic2(void)
+{
+    psp_tmr_ic_isr(HW_TMR_CH2);
+    IC2_IF = 0;
+}
+
+/**
+ * Input capture 3 interrupt
+ */
+void __ISR(_INPUT_CAPTURE_3_VECTOR, IPL_NAME(TMR_IC_PRIO)) isr_ic3(void)
+{
+    psp_tmr_ic_isr(HW_TMR_CH3);
+    IC3_IF = 0;
+}
+
+/**
+ * Input capture 4 interrupt
+ */
+void __ISR(_INPUT_CAPTURE_4_VECTOR, IPL_NAME(TMR_IC_PRIO)) isr_ic4(void)
+{
+    psp_tmr_ic_isr(HW_TMR_CH4);
+    IC4_IF = 0;
+}
+
+/**
+ * Input capture 5 interrupt
+ */
+void __ISR(_INPUT_CAPTURE_5_VECTOR, IPL_NAME(TMR_IC_PRIO)) isr_ic5(void)
+{
+    psp_tmr_ic_isr(HW_TMR_CH5);
+    IC5_IF = 0;
+}
+#endif
+
 /***********************
  *   STATIC FUNCTIONS
  ***********************/
@@ -363,4 +599,108 @@ static hw_res_t psp_tmr_id_test(tmr_t id)
     return res;
 }
 
+/**
+ * Get the interrupt flag of a timer
+ * @param tmr the id of a timer (HW_TMRx)
+ * @return true: the interrupt flag is set
+ */
+static bool psp_tmr_get_if(tmr_t tmr)
+{
+    switch(tmr)
+    {
+#if TMR2_EN != 0
+        case HW_TMR2:
+            return TIMER2_IF != 0 ? true : false;
+#endif
+#if TMR3_EN != 0
+        case HW_TMR3:
+            return TIMER3_IF != 0 ? true : false;
+#endif
+#if TMR4_EN != 0
+        case HW_TMR4:
+            return TIMER4_IF != 0 ? true : false;
+#endif
+#if TMR5_EN != 0
+        case HW_TMR5:
+            return TIMER5_IF != 0 ? true : false;
+#endif
+#if TMR6_EN != 0
+        case HW_TMR6:
+            return TIMER6_IF != 0 ? true : false;
+#endif
+        default:
+            return false;
+    }
+}
+
+/**
+ * Convert a counter value of a timer to microseconds
+ * @param tmr the id of a timer (HW_TMRx)
+ * @param cnt value of the counter
+ * @return microseconds since the period start
+ */
+static uint32_t psp_tmr_cnt_to_us(tmr_t tmr, uint32_t cnt)
+{
+    return ((uint64_t) cnt * m_dsc[tmr].period) / ((uint64_t) *reg_map[tmr].PRx + 1);
+}
+
+#if TMR_IC_PRIO != HW_INT_PRIO_OFF
+/**
+ * Enable or disable the interrupt of an input capture module
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param en true: enable, false: disable
+ */
+static void psp_tmr_ic_en_int(tmr_ch_t ch, bool en)
+{
+    uint8_t en_value = (en == false ?  0 : 1);
+
+    switch(ch)
+    {
+        case HW_TMR_CH1:
+            IC1_IF = 0;
+            IC1_IP = TMR_IC_PRIO;
+            IC1_IE = en_value;
+            break;
+        case HW_TMR_CH2:
+            IC2_IF = 0;
+            IC2_IP = TMR_IC_PRIO;
+            IC2_IE = en_value;
+            break;
+        case HW_TMR_CH3:
+            IC3_IF = 0;
+            IC3_IP = TMR_IC_PRIO;
+            IC3_IE = en_value;
+            break;
+        case HW_TMR_CH4:
+            IC4_IF = 0;
+            IC4_IP = TMR_IC_PRIO;
+            IC4_IE = en_value;
+            break;
+        case HW_TMR_CH5:
+            IC5_IF = 0;
+            IC5_IP = TMR_IC_PRIO;
+            IC5_IE = en_value;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Handle the captures of an input capture module
+ * @param ch the id of a channel (HW_TMR_CHx)
+ */
+static void psp_tmr_ic_isr(tmr_ch_t ch)
+{
+    ch_dsc_t * dsc = &ch_dsc[ch];
+    uint32_t cnt;
+
+    /*The flag remains set while the FIFO is not empty*/
+    while(dsc->ICxCON->ICBNE != 0) {
+        cnt = *dsc->ICxBUF & 0xFFFF;
+        if(dsc->ic_cb != NULL) dsc->ic_cb(ch, psp_tmr_cnt_to_us(dsc->ic_tmr, cnt));
+    }
+}
+#endif
+
 #endif
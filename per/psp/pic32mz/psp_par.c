@@ -10,12 +10,43 @@
 
 #if USE_PARALLEL != 0 && PSP_PIC32MZ != 0
 #include <xc.h>
+#include <sys/attribs.h>
+#include <sys/kmem.h>
+#include <stddef.h>
 #include "../psp_par.h"
 #include "hw/per/tick.h"
 
 /*********************
  *      DEFINES
  *********************/
+#ifndef PAR_ADR_EN
+#define PAR_ADR_EN      0       /*PMA pins used as address lines (PMAEN mask)*/
+#endif
+
+#ifndef PAR_DMA_PRIO
+#define PAR_DMA_PRIO    HW_INT_PRIO_OFF     /*No DMA: the async. writes are blocking*/
+#endif
+
+/*The DMA can't send the 16 bit words MSB first on 8 bit bus*/
+#define PAR_DMA_EN      (PAR_DMA_PRIO != HW_INT_PRIO_OFF && PAR_WIDTH == 16)
+
+/*DMA channel 7 feeds PMDIN*/
+#define PAR_DMA_IF      IFS4bits.DMA7IF
+#define PAR_DMA_IE      IEC4bits.DMA7IE
+#define PAR_DMA_IP      IPC35bits.DMA7IP
+
+#define PAR_DMA_CHUNK   0x7FFF      /*Max. words in a DMA block (DCHxSSIZ is 16 bit in bytes)*/
+
+#define PAR_WR(data) {while(PMMODEbits.BUSY != 0); PMDIN = (data);}
+#if PAR_WIDTH == 8
+#define PAR_WR_WORD(data) {PAR_WR((data) >> 8); PAR_WR((data) & 0xFF);}    /*MSB first*/
+#else
+#define PAR_WR_WORD(data) PAR_WR(data)
+#endif
+#define REPEATE8(cmd) {cmd; cmd; cmd; cmd; cmd; cmd; cmd; cmd;}
+
+#define IPL_NAME(prio) IPL_CONC(prio)
+#define IPL_CONC(prio) IPL ## prio ## AUTO
 
 /**********************
  *      TYPEDEFS
@@ -24,11 +55,22 @@
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+#if PAR_DMA_EN != 0
+static void psp_par_dma_next(void);
+#endif
+static inline void psp_par_set_adr(uint32_t adr);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
 static uint8_t act_wait = 0;
+static uint32_t act_adr = 0;
+#if PAR_DMA_EN != 0
+static const uint16_t * dma_buf;    /*Start of the next DMA block*/
+static volatile uint32_t dma_rem;   /*Words not sent yet by the DMA*/
+static volatile bool dma_act;
+static par_cb_t dma_cb;
+#endif
 
 /**********************
  *      MACROS
@@ -45,17 +87,48 @@ void psp_par_init(void)
 {
     PMCON = 0;
     
-    PMMODEbits.MODE = 0b10; /*Mode 2*/
+#if PAR_MODE == PAR_MODE_6800
+    PMMODEbits.MODE = 0b11; /*Master mode 1: PMRD/PMWR is R/W, PMWR/PMENB is E*/
+    PMCONbits.WRSP = 1;     /*E is active high*/
+    PMCONbits.RDSP = 1;     /*R/W is high on read*/
+#else
+    PMMODEbits.MODE = 0b10; /*Master mode 2: PMRD and PMWR*/
+#endif
     
     PMCONbits.PTWREN = 1;
     PMCONbits.PTRDEN = 1;
     
-    PMMODEbits.MODE16 = 1;
+    PMMODEbits.MODE16 = PAR_WIDTH == 16 ? 1 : 0;
     PMMODEbits.WAITB = PAR_WAITB - 1;
     PMMODEbits.WAITM = PAR_WAITM - 1;
     PMMODEbits.WAITE = PAR_WAITE - 1;
     
+    PMAEN = PAR_ADR_EN;
+    PMADDR = 0;
+    act_adr = 0;
+
+#if PAR_DMA_EN != 0
+    PMMODEbits.IRQM = 0b01;     /*PMP event at the end of every write cycle (DMA trigger)*/
+#endif
+
     PMCONbits.ON = 1;
+
+#if PAR_DMA_EN != 0
+    DMACONbits.ON = 1;
+    DCH7CON = 0;
+    DCH7ECON = 0;
+    DCH7ECONbits.CHSIRQ = _PMP_VECTOR;
+    DCH7ECONbits.SIRQEN = 1;
+    DCH7DSA = KVA_TO_PA(&PMDIN);
+    DCH7DSIZ = 2;
+    DCH7CSIZ = 2;
+    DCH7INT = 0;
+    DCH7INTbits.CHBCIE = 1;     /*Interrupt when a block is sent*/
+
+    PAR_DMA_IF = 0;
+    PAR_DMA_IP = PAR_DMA_PRIO;
+    PAR_DMA_IE = 1;
+#endif
 }
 
 /**
@@ -68,7 +141,46 @@ void psp_par_set_wait_time(uint8_t wait)
 }
 
 /**
- * Write an array to the parallel port
+ * Write one bus word (8 or 16 bit) to the parallel port
+ * @param adr address of writing
+ * @param data the data to write
+ */
+void psp_par_wr(uint32_t adr, uint16_t data)
+{
+#if PAR_DMA_EN != 0
+    while(dma_act != false);
+#endif
+    psp_par_set_adr(adr);
+
+    PAR_WR(data);
+}
+
+/**
+ * Read one bus word (8 or 16 bit) from the parallel port
+ * @param adr address of reading
+ * @return the read data
+ */
+uint16_t psp_par_rd(uint32_t adr)
+{
+    uint16_t data;
+
+#if PAR_DMA_EN != 0
+    while(dma_act != false);
+#endif
+    psp_par_set_adr(adr);
+
+    /*Reading PMDIN returns the data of the previous read cycle and starts a new one*/
+    while(PMMODEbits.BUSY != 0);
+    data = PMDIN;
+    while(PMMODEbits.BUSY != 0);
+    data = PMDIN;
+
+    return data;
+}
+
+/**
+ * Write an array to the parallel port.
+ * With 8 bit bus every word is sent in two cycles (MSB first).
  * @param adr start address of writing
  * @param buf pointer to the array to write
  * @param length length of the array in words
@@ -77,25 +189,198 @@ void psp_par_wr_array(uint32_t adr, const void * buf, uint32_t length)
 {
     uint32_t i;
     uint16_t * buf16_p = (uint16_t *) buf;
+
+#if PAR_DMA_EN != 0
+    while(dma_act != false);
+#endif
+    psp_par_set_adr(adr);
+
     for(i = 0; i < length; i++) {
-        while(PMMODEbits.BUSY != 0);
-        PMDIN = buf16_p[i];
+        PAR_WR_WORD(buf16_p[i]);
+    }
+}
+
+/**
+ * Write the same word to the parallel port multiple times.
+ * With 8 bit bus every word is sent in two cycles (MSB first).
+ * @param adr start address of writing
+ * @param data the word to write
+ * @param length number of words
+ */
+void psp_par_fill(uint32_t adr, uint16_t data, uint32_t length)
+{
+    uint32_t i;
+
+#if PAR_DMA_EN != 0
+    while(dma_act != false);
+#endif
+    psp_par_set_adr(adr);
+
+#if PAR_WIDTH == 8
+    uint8_t data_h = data >> 8;
+    uint8_t data_l = data & 0xFF;
+    if(data_h == data_l) {
+        /*Fill with bytes*/
+        data = data_l;
+        length = length << 1;
+    } else {
+        for(i = length >> 3; i != 0; i--) {
+            REPEATE8(PAR_WR(data_h); PAR_WR(data_l));
+        }
+        for(i = length & 0x7; i != 0; i--) {
+            PAR_WR(data_h);
+            PAR_WR(data_l);
+        }
+        return;
+    }
+#endif
+
+    for(i = length >> 3; i != 0; i--) {
+        REPEATE8(PAR_WR(data));
+    }
+
+    for(i = length & 0x7; i != 0; i--) {
+        PAR_WR(data);
+    }
+}
+
+/**
+ * Write an array to the parallel port in the background with DMA.
+ * On PIC32MZ 'buf' has to be in coherent memory (e.g. '__attribute__((coherent))')
+ * or written back from the data cache before calling this function.
+ * @param adr start address of writing
+ * @param buf pointer to the array to write. Has to be valid until 'cb' is called.
+ * @param length length of the array in words
+ * @param cb called from the interrupt when all the data is written (can be NULL)
+ * @return HW_RES_OK: the transfer is started,
+ *         HW_RES_DIS: no DMA is enabled (PAR_DMA_PRIO or 8 bit bus), use 'psp_par_wr_array'
+ */
+hw_res_t psp_par_wr_array_async(uint32_t adr, const void * buf, uint32_t length, par_cb_t cb)
+{
+#if PAR_DMA_EN != 0
+    while(dma_act != false);
+
+    if(length == 0) {
+        if(cb != NULL) cb();
+        return HW_RES_OK;
     }
+
+    psp_par_set_adr(adr);
+
+    dma_buf = buf;
+    dma_rem = length;
+    dma_cb = cb;
+    dma_act = true;
+
+    psp_par_dma_next();
+
+    return HW_RES_OK;
+#else
+    return HW_RES_DIS;
+#endif
+}
+
+/**
+ * Check the parallel port
+ * @return true: an asynchronous write or a write cycle is in progress
+ */
+bool psp_par_busy(void)
+{
+#if PAR_DMA_EN != 0
+    if(dma_act != false) return true;
+#endif
+    return PMMODEbits.BUSY != 0 ? true : false;
 }
 
 /**
- * Read data from the parallel port
+ * Read data from the parallel port.
+ * With 8 bit bus every word is read in two cycles (MSB first).
  * @param adr start address of reading
  * @param buf point to budder to store the result
  * @param length number of words to read
  */
 void psp_par_rd_array(uint32_t adr, void * buf, uint32_t length)
 {
-    
+    uint16_t * buf16_p = (uint16_t *) buf;
+    uint32_t i;
+
+    if(length == 0) return;
+
+#if PAR_DMA_EN != 0
+    while(dma_act != false);
+#endif
+    psp_par_set_adr(adr);
+
+    /* Reading PMDIN returns the data of the previous read cycle and starts a new one.
+     * So start with a dummy read. (The last read starts an unused read cycle too.)*/
+    while(PMMODEbits.BUSY != 0);
+    buf16_p[0] = PMDIN;
+
+    for(i = 0; i < length; i++) {
+        while(PMMODEbits.BUSY != 0);
+#if PAR_WIDTH == 8
+        buf16_p[i] = (PMDIN & 0xFF) << 8;
+        while(PMMODEbits.BUSY != 0);
+        buf16_p[i] |= PMDIN & 0xFF;
+#else
+        buf16_p[i] = PMDIN;
+#endif
+    }
 }
 
 /**********************
  *   STATIC FUNCTIONS
  **********************/
 
+/**
+ * Set the address lines (PMADDR) if they are changed
+ * @param adr the new address
+ */
+static inline void psp_par_set_adr(uint32_t adr)
+{
+    if(adr != act_adr) {
+        while(PMMODEbits.BUSY != 0);
+        PMADDR = adr;
+        act_adr = adr;
+    }
+}
+
+#if PAR_DMA_EN != 0
+/**
+ * Start the DMA with the next block of the async. write
+ */
+static void psp_par_dma_next(void)
+{
+    uint32_t len = dma_rem > PAR_DMA_CHUNK ? PAR_DMA_CHUNK : dma_rem;
+
+    DCH7SSA = KVA_TO_PA(dma_buf);
+    DCH7SSIZ = len * 2;
+    dma_buf += len;
+    dma_rem -= len;
+
+    DCH7INTCLR = 0xFF;
+    DCH7CONbits.CHEN = 1;
+
+    /*The PMP event of the previous write might be lost, so start the first cell manually*/
+    while(PMMODEbits.BUSY != 0);
+    DCH7ECONbits.CFORCE = 1;
+}
+
+/**
+ * A DMA block is sent. Start the next or finish the transfer.
+ */
+void __ISR(_DMA7_VECTOR, IPL_NAME(PAR_DMA_PRIO)) isr_par_dma(void)
+{
+    DCH7INTCLR = 0xFF;
+    PAR_DMA_IF = 0;
+
+    if(dma_rem != 0) {
+        psp_par_dma_next();
+    } else {
+        dma_act = false;
+        if(dma_cb != NULL) dma_cb();
+    }
+}
+#endif
+
 #endif
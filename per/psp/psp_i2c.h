@@ -19,6 +19,15 @@
 /*********************
  *      DEFINES
  *********************/
+#ifndef I2C1_SW
+#define I2C1_SW     0
+#endif
+#ifndef I2C2_SW
+#define I2C2_SW     0
+#endif
+#ifndef I2C_ASYNC_TOUT
+#define I2C_ASYNC_TOUT  50  /*Max. time of an asynchronous transaction [ms]*/
+#endif
 
 /**********************
  *      TYPEDEFS
@@ -31,15 +40,49 @@ typedef enum
     HW_I2CX = 0xFF /*always ignored*/
 }i2c_t;
 
+/*An asynchronous transaction: write 'wr_len' bytes then read 'rd_len' bytes (with repeated start).
+ *Write only: rd_len = 0, read only: wr_len = 0.
+ *The descriptor has to be valid until the callback is called*/
+typedef struct _i2c_trans_t
+{
+    uint8_t adr;                /*7 bit slave address*/
+    const uint8_t * wr_data;
+    uint16_t wr_len;
+    uint8_t * rd_data;
+    uint16_t rd_len;
+    void (*cb)(struct _i2c_trans_t * trans, hw_res_t res);  /*Called when ready (from interrupt)*/
+    void * user_data;           /*Free to use by the application*/
+    struct _i2c_trans_t * next; /*Used by the driver's queue*/
+}i2c_trans_t;
+
+#if PSP_PC != 0
+/*A simulated slave on the PC. The functions are called from the bus thread too*/
+typedef struct
+{
+    uint8_t adr;                /*7 bit address of the slave*/
+    bool (*start)(bool rd);     /*Addressed after (re)start. Return true to ACK*/
+    bool (*wr)(uint8_t data);   /*A byte is written by the master. Return true to ACK*/
+    uint8_t (*rd)(void);        /*Return the next byte to read by the master*/
+    void (*stop)(void);         /*Stop condition*/
+}psp_i2c_sim_t;
+#endif
+
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
 void psp_i2c_init(void);
+void psp_i2c_set_tout(i2c_t id, uint32_t tout);
 hw_res_t psp_i2c_start(i2c_t id);
 hw_res_t psp_i2c_restart(i2c_t id);
 hw_res_t psp_i2c_stop(i2c_t id);
 hw_res_t psp_i2c_wr(i2c_t id, uint8_t data);
 hw_res_t psp_i2c_rd(i2c_t id, uint8_t * data, bool ack);
+hw_res_t psp_i2c_xfer_async(i2c_t id, i2c_trans_t * trans);
+bool psp_i2c_busy(i2c_t id);
+void psp_i2c_en(i2c_t id, bool en);
+#if PSP_PC != 0
+void psp_i2c_set_sim(i2c_t id, const psp_i2c_sim_t * sim);
+#endif
 
 
 /**********************
@@ -14,15 +14,40 @@
 #if USE_PARALLEL != 0 
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "hw/hw.h"
 
 /*********************
  *      DEFINES
  *********************/
+#define PAR_MODE_8080   0   /*Separate RD and WR strobes*/
+#define PAR_MODE_6800   1   /*R/W signal (on the RD pin) and E strobe (on the WR pin)*/
+
+#ifndef PAR_WIDTH
+#define PAR_WIDTH   16      /*Data bus width: 8 or 16*/
+#endif
+
+#ifndef PAR_MODE
+#define PAR_MODE    PAR_MODE_8080
+#endif
+
+#if PAR_WIDTH != 8 && PAR_WIDTH != 16
+#error "PAR_WIDTH has to be 8 or 16"
+#endif
 
 /**********************
  *      TYPEDEFS
  **********************/
+typedef void (*par_cb_t)(void);    /*Called (from interrupt) when an asynchronous write is ready*/
+
+#if PSP_PC != 0
+/*Simulated device on the PC's parallel port*/
+typedef struct
+{
+    void (*wr)(uint32_t adr, uint16_t data);
+    uint16_t (*rd)(uint32_t adr);
+}psp_par_sim_t;
+#endif
 
 /**********************
  * GLOBAL PROTOTYPES
@@ -30,8 +55,16 @@
 
 void psp_par_init(void);
 void psp_par_set_wait_time(uint8_t wait);  /*PSP_PAR_SLOW to slow mode*/
+void psp_par_wr(uint32_t adr, uint16_t data);
+uint16_t psp_par_rd(uint32_t adr);
 void psp_par_wr_array(uint32_t adr, const void * buf, uint32_t length);
 void psp_par_rd_array(uint32_t adr, void * buf, uint32_t length);
+void psp_par_fill(uint32_t adr, uint16_t data, uint32_t length);
+hw_res_t psp_par_wr_array_async(uint32_t adr, const void * buf, uint32_t length, par_cb_t cb);
+bool psp_par_busy(void);
+#if PSP_PC != 0
+void psp_par_set_sim(const psp_par_sim_t * sim);
+#endif
 
 /**********************
  *      MACROS
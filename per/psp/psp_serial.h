@@ -41,7 +41,8 @@ typedef enum
     SERIAL_MODE_PAR_EVEN = 1 << 3,
     SERIAL_MODE_2_STOP =   1 << 4,
     SERIAL_MODE_TX_INV =   1 << 5,
-    SERIAL_MODE_RX_INV =   1 << 6
+    SERIAL_MODE_RX_INV =   1 << 6,
+    SERIAL_MODE_RS485 =    1 << 7,     /*Half-duplex, drive the DE/RE pin of the transceiver*/
 }serial_mode_t;
 
 /**********************
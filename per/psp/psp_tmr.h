@@ -11,6 +11,14 @@
  *********************/
 #include "hw_conf.h"
 
+#ifndef PSP_PC_VTIME
+#define PSP_PC_VTIME    0
+#endif
+
+#if PSP_PC_VTIME != 0 && USE_TMR == 0
+#error "PSP_PC_VTIME requires USE_TMR"
+#endif
+
 #if USE_TMR != 0
 
 #include "hw/hw.h"
@@ -37,14 +45,64 @@ typedef enum
     HW_TMRX = 0xFF /*TMRX means invalid/unused timer*/
 }tmr_t;
 
+/*Output compare (PWM) and input capture channels (OCx/ICx modules)*/
+typedef enum
+{
+    HW_TMR_CH1 = 0,
+    HW_TMR_CH2,
+    HW_TMR_CH3,
+    HW_TMR_CH4,
+    HW_TMR_CH5,
+    HW_TMR_CH_NUM,
+}tmr_ch_t;
+
+typedef enum
+{
+    TMR_IC_RISE = 0,
+    TMR_IC_FALL,
+    TMR_IC_BOTH,
+}tmr_ic_edge_t;
+
+/*Called from the input capture interrupt with the time of the edge
+ *(microseconds since the last period end of the timer, like 'tmr_get_us')*/
+typedef void (*tmr_ic_cb_t)(tmr_ch_t ch, uint32_t us);
+
+#if PSP_PC != 0
+/*Timing statistics of a simulated timer*/
+typedef struct
+{
+    uint32_t calls;     /*Number of callbacks*/
+    uint32_t missed;    /*Callbacks called more than a period late (caught up)*/
+    uint32_t late_max;  /*Longest delay of a callback from its deadline [us]*/
+    uint64_t late_sum;  /*Sum of the delays [us]*/
+}psp_tmr_stat_t;
+#endif
+
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
 void psp_tmr_init(void);
 hw_res_t psp_tmr_set_period(tmr_t tmr, uint32_t p_us);
+void psp_tmr_set_value(tmr_t tmr, uint32_t value);
 void psp_tmr_set_cb(tmr_t tmr, void (*cd) (void));
 void psp_tmr_en_int(tmr_t tmr, bool en);
 void psp_tmr_run(tmr_t tmr, bool en);
+uint32_t psp_tmr_get_us(tmr_t tmr);
+hw_res_t psp_tmr_pwm_init(tmr_ch_t ch, tmr_t tmr);
+hw_res_t psp_tmr_pwm_set(tmr_ch_t ch, uint16_t duty);
+void psp_tmr_pwm_stop(tmr_ch_t ch);
+hw_res_t psp_tmr_ic_init(tmr_ch_t ch, tmr_t tmr, tmr_ic_edge_t edge, tmr_ic_cb_t cb);
+void psp_tmr_ic_stop(tmr_ch_t ch);
+#if PSP_PC != 0
+void psp_tmr_get_stat(tmr_t tmr, psp_tmr_stat_t * st);
+void psp_tmr_clr_stat(tmr_t tmr);
+uint16_t psp_tmr_pwm_get(tmr_ch_t ch);
+void psp_tmr_ic_sim(tmr_ch_t ch, bool rise);
+#if PSP_PC_VTIME != 0
+void psp_tmr_vt_adv(uint32_t us);
+uint64_t psp_tmr_vt_get(void);
+#endif
+#endif
 
 /**********************
  *      MACROS
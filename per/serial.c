@@ -37,6 +37,7 @@
 /***********************
  *   STATIC PROTOTYPES
  ***********************/
+static bool serial_wait(uint32_t start, uint32_t tout);
 
 /***********************
  *   GLOBAL FUNCTIONS
@@ -94,21 +95,28 @@ hw_res_t serial_send(serial_t id, const void * tx_buf, int32_t * length)
  * @param modul_id the id of an SERIAL modul
  * @param tx_buf pointer to a buffer where the data to send is stored
  * @param length the length of tx_buf in bytes (SERIAL_SEND_STRING can  be used)
- * @return HW_RES_OK or error
+ * @param tout max. time to wait in milliseconds (SERIAL_TOUT_INF: no timeout)
+ * @return HW_RES_OK or error (HW_RES_TOUT if not all bytes are buffered in time)
  */
-hw_res_t serial_send_force(serial_t id, const void * tx_buf, int32_t length)
+hw_res_t serial_send_force(serial_t id, const void * tx_buf, int32_t length, uint32_t tout)
 {
     hw_res_t res = HW_RES_OK;
     
     const uint8_t * buf8 = tx_buf;
     uint32_t i;
+    uint32_t start = 0;
     if(length == SERIAL_SEND_STRING) length = strlen(tx_buf);
+#if USE_TICK != 0
+    start = tick_get();
+#endif
 
     for(i = 0; i < length; i++) {
         do {
             res = psp_serial_wr(id, buf8[i]);
             if(res == HW_RES_FULL) {
-                tick_wait_ms(1);
+                if(serial_wait(start, tout) != false) {
+                    res = HW_RES_TOUT;
+                }
             }
         } while(res == HW_RES_FULL);
         
@@ -161,21 +169,31 @@ hw_res_t serial_rec(serial_t id, void * rx_buf, uint32_t * length)
  * @param id the id of an SERIAL modul
  * @param rx_buf the received bytes will be stored here
  * @param length how many bytes should be received
- * @return HW_RES_OK or error
+ * @param tout max. time to wait in milliseconds (SERIAL_TOUT_INF: no timeout)
+ * @return HW_RES_OK or error (HW_RES_TOUT if not all bytes are received in time)
  */
-hw_res_t serial_rec_force(serial_t id, void * rx_buf, uint32_t length)
+hw_res_t serial_rec_force(serial_t id, void * rx_buf, uint32_t length, uint32_t tout)
 {
      hw_res_t res = HW_RES_OK;
    
     uint8_t * buf8 = rx_buf;
     uint32_t i = 0;
+    uint32_t start = 0;
+#if USE_TICK != 0
+    start = tick_get();
+#endif
 
     while(i < length) {
         res = psp_serial_rd(id, &buf8[i]);
 
         /*Check the return value*/
         if (res == HW_RES_OK) i++;
-        else if (res == HW_RES_EMPTY)  tick_wait_ms(1);
+        else if (res == HW_RES_EMPTY) {
+            if(serial_wait(start, tout) != false) {
+                res = HW_RES_TOUT;
+                break;
+            }
+        }
         else  break;
     }
     //Return with the result
@@ -215,4 +233,27 @@ uint32_t serial_get_send_time(uint32_t byte_num, uint32_t baud)
  *   STATIC FUNCTIONS
  ***********************/
 
+/**
+ * Wait a little in the blocking functions and check the timeout
+ * @param start time stamp of the start of the operation (from 'tick_get')
+ * @param tout the timeout in milliseconds (SERIAL_TOUT_INF: no timeout)
+ * @return true: the timeout is elapsed
+ */
+static bool serial_wait(uint32_t start, uint32_t tout)
+{
+#if USE_TICK != 0
+    if(tout != SERIAL_TOUT_INF && tick_elaps(start) >= tout) return true;
+    
+    /*Let the application do other things meanwhile*/
+    tick_yield();
+#else
+    /*Without tick the timeout is not supported*/
+    (void) start;
+    (void) tout;
+    tick_wait_ms(1);
+#endif
+
+    return false;
+}
+
 #endif
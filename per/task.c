@@ -0,0 +1,216 @@
+/**
+ * @file task.c
+ * Cooperative task scheduler. 'task_run' runs the ready tasks once
+ * and measures their run time with 'tick_get_us'.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "hw_conf.h"
+#if USE_TASK != 0
+
+#include <stddef.h>
+#include "task.h"
+#include "tick.h"
+#include "hw/per/tmr.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define TASK_VTIME      (PSP_PC != 0 && PSP_PC_VTIME != 0)  /*Let the virtual time pass if the tasks only wait*/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void task_exec(task_t * task);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static task_t * task_head;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Initialize a task. Has to be called before 'task_add'.
+ * @param task pointer to a task (has to be valid while added)
+ * @param fp the task function. Use the TASK_... macros in it.
+ * @param ctx free to use by the task (task->ctx)
+ */
+void task_init(task_t * task, task_res_t (*fp)(task_t *), void * ctx)
+{
+    task->next = NULL;
+    task->fp = fp;
+    task->ctx = ctx;
+    task->wake = 0;
+    task->budget = 0;
+    task->lc = 0;
+    task->sleep = false;
+    task->act = false;
+    task_clr_stat(task);
+}
+
+/**
+ * Add a task to the scheduler. It starts at the next 'task_run'.
+ * @param task pointer to an initialized task
+ */
+void task_add(task_t * task)
+{
+    task_t ** p = &task_head;
+
+    /*Add to the end to run in the order of adding*/
+    while(*p != NULL) {
+        if(*p == task) return;      /*Already added*/
+        p = &(*p)->next;
+    }
+
+    task->next = NULL;
+    *p = task;
+}
+
+/**
+ * Remove a task from the scheduler. The task can remove itself too.
+ * @param task pointer to a task
+ */
+void task_rem(task_t * task)
+{
+    task_t ** p = &task_head;
+
+    while(*p != NULL) {
+        if(*p == task) {
+            *p = task->next;
+            break;
+        }
+        p = &(*p)->next;
+    }
+}
+
+/**
+ * Run the ready tasks once. Call it from the main loop.
+ * It can be the yield function of the tick too ('tick_set_yield')
+ * to run the other tasks while a driver blocks. The waiting task is not run again.
+ * With virtual time the clock is advanced if the tasks didn't let it pass:
+ * to the earliest wake up if every task sleeps, else by at most 1 ms
+ * (for the tasks polling the time in 'TASK_WAIT_UNTIL').
+ */
+void task_run(void)
+{
+    task_t * task = task_head;
+    task_t * next;
+#if TASK_VTIME != 0
+    uint32_t start = tick_get();
+    uint32_t adv = UINT32_MAX;
+    uint32_t rem;
+#endif
+
+    while(task != NULL) {
+        next = task->next;      /*The task can remove itself*/
+        if(task->act == false) {
+            if(task->sleep == false || tick_elaps(task->wake) < UINT32_MAX / 2) {
+                task->sleep = false;
+                task_exec(task);
+#if TASK_VTIME != 0
+                adv = 1;
+#endif
+            }
+#if TASK_VTIME != 0
+            else {
+                rem = task->wake - tick_get();
+                if(rem < adv) adv = rem;
+            }
+#endif
+        }
+        task = next;
+    }
+
+#if TASK_VTIME != 0
+    /*Nothing waited in the tasks: jump to the next event instead of spinning*/
+    if(adv != UINT32_MAX && tick_get() == start) {
+        psp_tmr_vt_adv(adv * 1000);
+    }
+#endif
+}
+
+/**
+ * Don't run a task for some time. Use 'TASK_SLEEP_MS' in the tasks.
+ * @param task pointer to a task
+ * @param ms the time to sleep [ms]
+ */
+void task_sleep(task_t * task, uint32_t ms)
+{
+    task->wake = tick_get() + ms;
+    task->sleep = true;
+}
+
+/**
+ * Set the time budget of a task. The longer runs are counted in the statistics.
+ * @param task pointer to a task
+ * @param us max. time of a run [us], 0: no limit
+ */
+void task_set_budget(task_t * task, uint32_t us)
+{
+    task->budget = us;
+}
+
+/**
+ * Get the run time statistics of a task
+ * @param task pointer to a task
+ * @param st pointer to a variable to store the statistics
+ */
+void task_get_stat(task_t * task, task_stat_t * st)
+{
+    *st = task->stat;
+}
+
+/**
+ * Clear the run time statistics of a task
+ * @param task pointer to a task
+ */
+void task_clr_stat(task_t * task)
+{
+    task->stat.run = 0;
+    task->stat.over = 0;
+    task->stat.exec_max = 0;
+    task->stat.exec_sum = 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Run a task once and measure its run time
+ * @param task pointer to a ready task
+ */
+static void task_exec(task_t * task)
+{
+    uint64_t start;
+    uint32_t exec;
+    task_res_t res;
+
+    task->act = true;
+    start = tick_get_us();
+    res = task->fp(task);
+    exec = tick_elaps_us(start);
+    task->act = false;
+
+    task->stat.run++;
+    task->stat.exec_sum += exec;
+    if(exec > task->stat.exec_max) task->stat.exec_max = exec;
+    if(task->budget != 0 && exec > task->budget) task->stat.over++;
+
+    if(res == TASK_RES_END) task_rem(task);
+}
+
+#endif
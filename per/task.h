@@ -0,0 +1,104 @@
+/**
+ * @file task.h
+ * Cooperative, stackless tasks (protothreads) on the tick.
+ * A task is a function which continues where it yielded last time:
+ *
+ *  static task_res_t blink(task_t * t)
+ *  {
+ *      TASK_BEGIN(t);
+ *      while(1) {
+ *          led_on(LED1);
+ *          TASK_SLEEP_MS(t, 100);
+ *          led_off(LED1);
+ *          TASK_SLEEP_MS(t, 900);
+ *      }
+ *      TASK_END(t);
+ *  }
+ *
+ * The local variables are lost at yield, keep the state in 'ctx' or in static variables.
+ * 'switch' can't be used around the TASK_... macros and only one of them can be in a line.
+ */
+
+#ifndef TASK_H
+#define TASK_H
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "hw_conf.h"
+#if USE_TASK != 0
+
+#if USE_TICK == 0
+#error "USE_TASK requires USE_TICK"
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hw/hw.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef enum
+{
+    TASK_RES_YIELD = 0,     /*Continue at the next run*/
+    TASK_RES_END,           /*Finished, remove it*/
+}task_res_t;
+
+typedef struct
+{
+    uint32_t run;       /*Number of runs*/
+    uint32_t over;      /*Runs longer than the budget*/
+    uint32_t exec_max;  /*Longest run [us]*/
+    uint64_t exec_sum;  /*Total run time [us]*/
+}task_stat_t;
+
+/*A task. The fields are private, use the 'task_...' functions and the TASK_... macros*/
+typedef struct _task_t
+{
+    struct _task_t * next;
+    task_res_t (*fp)(struct _task_t * task);
+    void * ctx;                 /*Free to use by the task*/
+    uint32_t wake;              /*Tick to continue after 'TASK_SLEEP_MS'*/
+    uint32_t budget;            /*Max. time of a run [us], 0: no limit*/
+    task_stat_t stat;
+    uint16_t lc;                /*Line to continue (local continuation)*/
+    bool sleep;
+    bool act;                   /*Running now (e.g. a driver yields inside)*/
+}task_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+void task_init(task_t * task, task_res_t (*fp)(task_t *), void * ctx);
+void task_add(task_t * task);
+void task_rem(task_t * task);
+void task_run(void);
+void task_sleep(task_t * task, uint32_t ms);
+void task_set_budget(task_t * task, uint32_t us);
+void task_get_stat(task_t * task, task_stat_t * st);
+void task_clr_stat(task_t * task);
+
+/**********************
+ *      MACROS
+ **********************/
+#define TASK_BEGIN(t)       switch((t)->lc) { case 0:
+
+#define TASK_END(t)         } (t)->lc = 0; return TASK_RES_END
+
+/*Let the other tasks run and continue here*/
+#define TASK_YIELD(t)       do { (t)->lc = __LINE__; return TASK_RES_YIELD; case __LINE__:; } while(0)
+
+/*Yield until 'cond' is true (it is checked again at every run)*/
+#define TASK_WAIT_UNTIL(t, cond)    do { while(!(cond)) TASK_YIELD(t); } while(0)
+
+/*Let the other tasks run for 'ms' milliseconds*/
+#define TASK_SLEEP_MS(t, ms)        do { task_sleep(t, ms); TASK_YIELD(t); } while(0)
+
+#endif
+
+#endif
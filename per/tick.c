@@ -16,17 +16,49 @@
 /*********************
  *      DEFINES
  *********************/
+#ifndef TICK_US_BASE
+#define TICK_US_BASE    5       /*Initial guess of the wait loops in a microsecond*/
+#endif
+
+#define TICK_CALIB_US   500     /*Length of a calibration run [us]. Short to work without the tick interrupt too.*/
+
+#ifndef TICK_WHEEL_SIZE
+#define TICK_WHEEL_SIZE 32      /*Slots of the timer wheel (power of 2)*/
+#endif
+
+#if (TICK_WHEEL_SIZE & (TICK_WHEEL_SIZE - 1)) != 0
+#error "TICK_WHEEL_SIZE has to be a power of 2"
+#endif
+
+#define TICK_WHEEL_MASK (TICK_WHEEL_SIZE - 1)
+
+#define TICK_VTIME      (PSP_PC != 0 && PSP_PC_VTIME != 0)  /*The waits let the virtual time pass*/
 
 /**********************
  *      TYPEDEFS
  **********************/
+#if TICK_FUNC_NUM != 0
+/*Adapter of the 'tick_add_func' callbacks to the timers*/
+typedef struct
+{
+    tick_tmr_t tmr;
+    void (*fp)(void);
+}tick_func_t;
+#endif
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 static void sys_time_inc(void);
+#if TICK_VTIME == 0
+static void tick_calib(void);
+#endif
+static void tick_tmr_ins(tick_tmr_t * tmr);
+static void tick_tmr_unlink(tick_tmr_t * tmr);
+static void tick_tmr_lock(void);
+static void tick_tmr_unlock(void);
 #if TICK_FUNC_NUM != 0
-static void (*systick_cb_a[TICK_FUNC_NUM]) (void);
+static void tick_func_cb(void * ctx);
 #endif
 
 /**********************
@@ -34,6 +66,18 @@ static void (*systick_cb_a[TICK_FUNC_NUM]) (void);
  **********************/
 volatile bool started = false; 
 volatile uint32_t sys_time = 0;
+static volatile uint32_t sys_time_h = 0;    /*Overflows of 'sys_time'*/
+static void (*yield_fp)(void) = NULL;
+static bool yield_run = false;
+static uint32_t ms_loops = TICK_US_BASE * 1000;  /*'tick_wait_loops' iterations in a millisecond*/
+static tick_tmr_t * wheel[TICK_WHEEL_SIZE];       /*Timers by the low bits of their expire time*/
+static tick_tmr_t * tmr_next;                     /*Next timer to check in 'sys_time_inc'*/
+static volatile uint8_t lock_cnt = 0;            /*Nesting of 'tick_tmr_lock'*/
+static tick_work_t * work_head;                   /*Queue of the posted works*/
+static tick_work_t * work_tail;
+#if TICK_FUNC_NUM != 0
+static tick_func_t func_a[TICK_FUNC_NUM];
+#endif
 
 /**********************
  *      MACROS
@@ -52,21 +96,31 @@ void tick_init(void)
     tmr_set_period(TICK_TIMER, 1000);
     tmr_set_cb(TICK_TIMER, sys_time_inc);
     tmr_run(TICK_TIMER, true);
+
+#if TICK_VTIME == 0
+    tick_calib();
+#endif
 }
 
 /**
- * Get the elapsed sys. tick 
+ * Get the elapsed sys. tick without disabling the tick interrupt.
+ * On 16 bit cores it should not be called from interrupts with higher priority than TICK_TIMER.
  * @return Elapsed milliseconds since system start
  */
 uint32_t tick_get(void)
 {
+#if PSP_PIC24F_33F != 0
     uint32_t sys_time_tmp;
-    
-    tmr_en_int(TICK_TIMER, false);  /*Disable interrupt while reading*/
-    sys_time_tmp = sys_time;
-    tmr_en_int(TICK_TIMER, true);  /*Re-enable interrupts*/
-    
+
+    /*The 32 bit read is done in two steps. Repeat if the interrupt changed it meanwhile.*/
+    do {
+        sys_time_tmp = sys_time;
+    } while(sys_time_tmp != sys_time);
+
     return sys_time_tmp;
+#else
+    return sys_time;    /*An aligned 32 bit read is atomic*/
+#endif
 }
 
 
@@ -91,12 +145,61 @@ uint32_t tick_elaps(uint32_t time_prev)
     return time_prev;
 }
 
+/**
+ * Get the elapsed milliseconds without overflow
+ * @return Elapsed milliseconds since system start
+ */
+uint64_t tick_get64(void)
+{
+    uint64_t sys_time_tmp;
+
+    tick_tmr_lock();    /*Disable interrupt while reading*/
+    sys_time_tmp = ((uint64_t) sys_time_h << 32) | sys_time;
+    tick_tmr_unlock();
+
+    return sys_time_tmp;
+}
+
+/**
+ * Get the elapsed microseconds. The milliseconds are completed by the counter of TICK_TIMER.
+ * @return Elapsed microseconds since system start
+ */
+uint64_t tick_get_us(void)
+{
+    uint64_t ms;
+    uint32_t us;
+
+    tick_tmr_lock();    /*Disable interrupt while reading*/
+    ms = ((uint64_t) sys_time_h << 32) | sys_time;
+    us = tmr_get_us(TICK_TIMER);   /*Counts the pending millisecond too*/
+    tick_tmr_unlock();
+
+    return ms * 1000 + us;
+}
+
+/**
+ * Get the elapsed microseconds since a pervious time
+ * @param time_prev a pervious time stamp from 'tick_get_us'
+ * @return the elapsed microseconds
+ */
+uint64_t tick_elaps_us(uint64_t time_prev)
+{
+    return tick_get_us() - time_prev;
+}
+
 /**
  * Wait a given number of milliseconds
  * @param delay the desired delay in milliseconds
  */
 void tick_wait_ms (uint32_t delay)
 {
+#if TICK_VTIME != 0
+    while(delay > 1000) {
+        psp_tmr_vt_adv(1000 * 1000);
+        delay -= 1000;
+    }
+    psp_tmr_vt_adv(delay * 1000);
+#else
     if(started == false) {
         uint32_t i;
         for(i = 0; i < delay; i++) {
@@ -109,20 +212,243 @@ void tick_wait_ms (uint32_t delay)
             tick_wait_us(100);
         }
     }
+#endif
 }
 
 /**
  * Wait a given number of microseconds. 
- * Has to be adjusted with TICK_US_BASE in misc_conf.h
- * @param delay the desired delay in milliseconds
+ * The wait loop is calibrated against TICK_TIMER in 'tick_init'.
+ * @param delay the desired delay in microseconds
  */
 void tick_wait_us (uint32_t delay)
 {
-    volatile uint32_t i,j,k = 0;
+#if TICK_VTIME != 0
+    psp_tmr_vt_adv(delay);
+#else
+    while(delay > 1000) {
+        tick_wait_loops(ms_loops);
+        delay -= 1000;
+    }
 
-    for(i=0;i<delay;i++) {
-        for(j=0;j < TICK_US_BASE; j++) k++;
+    tick_wait_loops((delay * ms_loops) / 1000);
+#endif
+}
+
+/**
+ * Get the speed of the wait loop to make short delays without division.
+ * It is calibrated against TICK_TIMER in 'tick_init'.
+ * @return 'tick_wait_loops' iterations in a millisecond
+ */
+uint32_t tick_get_ms_loops(void)
+{
+    return ms_loops;
+}
+
+/**
+ * The wait loop of 'tick_wait_us'. In virtual time it does not let the time pass.
+ * @param n number of iterations (see 'tick_get_ms_loops')
+ */
+void tick_wait_loops(uint32_t n)
+{
+    volatile uint32_t i;
+
+    for(i = 0; i < n; i++);
+}
+
+/**
+ * Set a function to call while a blocking driver function waits for a slow peer
+ * (e.g. 'serial_send_force', 'i2c_read'). It can keep a cooperative main loop alive.
+ * The function must not use the peripheral which is waiting.
+ * @param fp pointer to a void func(void) function or NULL to disable
+ */
+void tick_set_yield(void (*fp)(void))
+{
+    yield_fp = fp;
+}
+
+/**
+ * Call the yield function (if set). Nested calls from the yield function are ignored.
+ */
+void tick_yield(void)
+{
+    if(yield_fp == NULL || yield_run != false) return;
+    
+    yield_run = true;
+    yield_fp();
+    yield_run = false;
+}
+
+/**
+ * Initialize a timer. Has to be called once before the other 'tick_tmr_...' functions.
+ * @param tmr pointer to a timer (has to be valid while running)
+ * @param cb the function to call when the timer expires (from the tick interrupt)
+ * @param ctx passed to 'cb'
+ */
+void tick_tmr_init(tick_tmr_t * tmr, void (*cb)(void *), void * ctx)
+{
+    tmr->next = NULL;
+    tmr->prev = NULL;
+    tmr->cb = cb;
+    tmr->ctx = ctx;
+    tmr->expire = 0;
+    tmr->period = 0;
+    tmr->act = false;
+}
+
+/**
+ * Start or restart a timer. Can be called from a timer callback too.
+ * @param tmr pointer to an initialized timer
+ * @param delay milliseconds until the first call (0 is handled as 1)
+ * @param period milliseconds between the further calls. 0: one-shot timer
+ */
+void tick_tmr_start(tick_tmr_t * tmr, uint32_t delay, uint32_t period)
+{
+    if(delay == 0) delay = 1;
+
+    tick_tmr_lock();
+    if(tmr->act != false) tick_tmr_unlink(tmr);
+    tmr->expire = sys_time + delay;
+    tmr->period = period;
+    tick_tmr_ins(tmr);
+    tick_tmr_unlock();
+}
+
+/**
+ * Stop a timer. Can be called from a timer callback too.
+ * @param tmr pointer to an initialized timer
+ */
+void tick_tmr_stop(tick_tmr_t * tmr)
+{
+    tick_tmr_lock();
+    if(tmr->act != false) tick_tmr_unlink(tmr);
+    tick_tmr_unlock();
+}
+
+/**
+ * Check a timer
+ * @param tmr pointer to an initialized timer
+ * @return true: the timer is running
+ */
+bool tick_tmr_act(const tick_tmr_t * tmr)
+{
+    return tmr->act;
+}
+
+/**
+ * Initialize a deferred work item. Has to be called once before the other 'tick_work_...' functions.
+ * @param work pointer to a work item (has to be valid while posted)
+ * @param fp the function to execute from 'tick_work_run'
+ * @param ctx passed to 'fp'
+ */
+void tick_work_init(tick_work_t * work, void (*fp)(void *), void * ctx)
+{
+    work->next = NULL;
+    work->fp = fp;
+    work->ctx = ctx;
+    work->post_time = 0;
+    work->pend = false;
+    tick_work_clr_stat(work);
+}
+
+/**
+ * Post a work to be executed by 'tick_work_run'.
+ * Can be called from the main loop or a tick timer callback (the top half).
+ * @param work pointer to an initialized work item
+ * @return true: queued, false: it was already pending (it will run only once)
+ */
+bool tick_work_post(tick_work_t * work)
+{
+    uint64_t now = tick_get_us();
+    bool queued = false;
+
+    tick_tmr_lock();
+    if(work->pend != false) {
+        work->stat.merged++;
+    } else {
+        work->pend = true;
+        work->next = NULL;
+        work->post_time = now;
+        if(work_head == NULL) work_head = work;
+        else work_tail->next = work;
+        work_tail = work;
+        queued = true;
     }
+    tick_tmr_unlock();
+
+    return queued;
+}
+
+/**
+ * Execute the posted works (the bottom halves). Call it periodically from the main loop.
+ * Only the works posted before the call are executed to keep it bounded.
+ * @return number of executed works
+ */
+uint32_t tick_work_run(void)
+{
+    tick_work_t * work;
+    tick_work_t * last;
+    uint64_t start;
+    uint32_t lat;
+    uint32_t exec;
+    uint32_t n = 0;
+
+    tick_tmr_lock();
+    last = work_tail;
+    tick_tmr_unlock();
+
+    if(last == NULL) return 0;
+
+    do {
+        tick_tmr_lock();
+        work = work_head;
+        work_head = work->next;
+        if(work_head == NULL) work_tail = NULL;
+        work->pend = false;     /*Can be posted again from now*/
+        tick_tmr_unlock();
+
+        start = tick_get_us();
+        lat = start - work->post_time;
+        work->fp(work->ctx);
+        exec = tick_elaps_us(start);
+
+        tick_tmr_lock();
+        work->stat.run++;
+        work->stat.exec_sum += exec;
+        if(exec > work->stat.exec_max) work->stat.exec_max = exec;
+        if(lat > work->stat.lat_max) work->stat.lat_max = lat;
+        tick_tmr_unlock();
+
+        n++;
+    } while(work != last);
+
+    return n;
+}
+
+/**
+ * Get the timing statistics of a work
+ * @param work pointer to an initialized work item
+ * @param st pointer to a variable to store the statistics
+ */
+void tick_work_get_stat(tick_work_t * work, tick_work_stat_t * st)
+{
+    tick_tmr_lock();
+    *st = work->stat;
+    tick_tmr_unlock();
+}
+
+/**
+ * Clear the timing statistics of a work
+ * @param work pointer to an initialized work item
+ */
+void tick_work_clr_stat(tick_work_t * work)
+{
+    tick_tmr_lock();
+    work->stat.run = 0;
+    work->stat.merged = 0;
+    work->stat.lat_max = 0;
+    work->stat.exec_max = 0;
+    work->stat.exec_sum = 0;
+    tick_tmr_unlock();
 }
 
 #if TICK_FUNC_NUM != 0
@@ -135,17 +461,21 @@ bool tick_add_func(void(*fp)(void))
 {    
     bool suc = false;
     
-    tmr_en_int(TICK_TIMER, false);  /*Disable interrupt while reading*/
+    tick_tmr_lock();
     
     uint8_t i;
     for(i = 0; i < TICK_FUNC_NUM; i++) {
-        if(systick_cb_a[i] == NULL) {
-            systick_cb_a[i] = fp;
+        if(func_a[i].fp == NULL) {
+            func_a[i].fp = fp;
+            tick_tmr_init(&func_a[i].tmr, tick_func_cb, &func_a[i]);
+            func_a[i].tmr.expire = sys_time + 1;
+            func_a[i].tmr.period = 1;
+            tick_tmr_ins(&func_a[i].tmr);
             suc = true;
             break;
         }
     }
-    tmr_en_int(TICK_TIMER, true);  /*Re-enable interrupts*/
+    tick_tmr_unlock();
     
     return suc;
 }
@@ -157,22 +487,60 @@ bool tick_add_func(void(*fp)(void))
  */
 void tick_rem_func(void(*fp)(void))
 {
-    tmr_en_int(TICK_TIMER, false);  /*Disable interrupt while reading*/
+    tick_tmr_lock();
     
     uint8_t i;
     for(i = 0; i < TICK_FUNC_NUM; i++) {
-        if(systick_cb_a[i] == fp) {
-            systick_cb_a[i] = NULL;
+        if(func_a[i].fp == fp) {
+            if(func_a[i].tmr.act != false) tick_tmr_unlink(&func_a[i].tmr);
+            func_a[i].fp = NULL;
             break;
         }
     }
-    tmr_en_int(TICK_TIMER, true);  /*Re-enable interrupts*/
+    tick_tmr_unlock();
 }
 #endif
 /**********************
  *   STATIC FUNCTIONS
  **********************/
 
+#if TICK_VTIME == 0
+/**
+ * Measure the speed of 'tick_wait_loops' with 'tick_get_us'.
+ * The fastest of some runs is used because interrupts can make a run slower.
+ */
+static void tick_calib(void)
+{
+    uint32_t n = TICK_US_BASE * 100;
+    uint32_t t = 0;
+    uint32_t best = 0;
+    uint64_t start;
+    uint8_t i;
+
+    /*Find a loop count which takes measurable time*/
+    for(i = 0; i < 8; i++) {
+        start = tick_get_us();
+        tick_wait_loops(n);
+        t = tick_elaps_us(start);
+        if(t >= TICK_CALIB_US / 8) break;
+        n = n * 8;
+    }
+
+    if(t == 0) return;      /*The timer is not running. Keep TICK_US_BASE.*/
+
+    n = ((uint64_t) n * TICK_CALIB_US) / t;
+
+    for(i = 0; i < 3; i++) {
+        start = tick_get_us();
+        tick_wait_loops(n);
+        t = tick_elaps_us(start);
+        if(t != 0 && ((uint64_t) n * 1000) / t > best) best = ((uint64_t) n * 1000) / t;
+    }
+
+    if(best != 0) ms_loops = best;
+}
+#endif
+
 /**
  * Increase the sys ticks and run the call backs
  */
@@ -180,18 +548,93 @@ static void sys_time_inc(void)
 {
     started = true;
     sys_time ++;
+    if(sys_time == 0) sys_time_h++;
     
-#if TICK_FUNC_NUM != 0
-    /*Run the callback functions*/
-    uint8_t i;
-    for(i = 0; i < TICK_FUNC_NUM; i++) {
-        if(systick_cb_a[i] != NULL) {
-            systick_cb_a[i]();
+    /*Only the timers in the actual slot can expire*/
+    tick_tmr_t * tmr = wheel[sys_time & TICK_WHEEL_MASK];
+    while(tmr != NULL) {
+        tmr_next = tmr->next;   /*'tick_tmr_stop' in 'cb' can remove the next timer*/
+        if(tmr->expire == sys_time) {
+            tick_tmr_unlink(tmr);
+            if(tmr->period != 0) {
+                tmr->expire = sys_time + tmr->period;
+                tick_tmr_ins(tmr);
+            }
+            tmr->cb(tmr->ctx);
         }
+        tmr = tmr_next;
     }
-#endif
 }
 
+/**
+ * Insert a timer to the slot of its expire time.
+ * Inserted to the head to not reach it again in the running 'sys_time_inc'.
+ * @param tmr pointer to an inactive timer
+ */
+static void tick_tmr_ins(tick_tmr_t * tmr)
+{
+    tick_tmr_t ** slot = &wheel[tmr->expire & TICK_WHEEL_MASK];
+
+    tmr->prev = NULL;
+    tmr->next = *slot;
+    if(*slot != NULL) (*slot)->prev = tmr;
+    *slot = tmr;
+    tmr->act = true;
+}
+
+/**
+ * Remove a timer from its slot
+ * @param tmr pointer to an active timer
+ */
+static void tick_tmr_unlink(tick_tmr_t * tmr)
+{
+    if(tmr_next == tmr) tmr_next = tmr->next;
+
+    if(tmr->prev != NULL) tmr->prev->next = tmr->next;
+    else wheel[tmr->expire & TICK_WHEEL_MASK] = tmr->next;
+    if(tmr->next != NULL) tmr->next->prev = tmr->prev;
+
+    tmr->next = NULL;
+    tmr->prev = NULL;
+    tmr->act = false;
+}
+
+/**
+ * Protect the timers and the work queue from the tick interrupt.
+ * Always taken because an interrupt with the same or lower priority as TICK_TIMER 
+ * (or an other thread on PC) can't tell if the tick callbacks are running.
+ * Interrupts with higher priority are not masked, they must not use the timers (see tick.h).
+ * Can be nested: only the outermost 'tick_tmr_unlock' enables the interrupt again.
+ */
+static void tick_tmr_lock(void)
+{
+    tmr_en_int(TICK_TIMER, false);
+    lock_cnt++;
+    tmr_en_int(TICK_TIMER, false);  /*An interrupt before the increment might have enabled it*/
+}
+
+/**
+ * Release the timers after 'tick_tmr_lock'
+ */
+static void tick_tmr_unlock(void)
+{
+    lock_cnt--;
+    if(lock_cnt == 0) tmr_en_int(TICK_TIMER, true);
+}
+
+#if TICK_FUNC_NUM != 0
+/**
+ * Call a function added by 'tick_add_func'
+ * @param ctx pointer to a 'tick_func_t'
+ */
+static void tick_func_cb(void * ctx)
+{
+    tick_func_t * f = ctx;
+
+    f->fp();
+}
+#endif
+
 #else
 #if TICK_BLOCK_WAIT != 0
 #include "tick.h"
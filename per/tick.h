@@ -22,6 +22,40 @@
 /**********************
  *      TYPEDEFS
  **********************/
+/*A software timer of the tick. The fields are private, see 'tick_tmr_...'.
+ *The 'tick_tmr_...', 'tick_work_...', 'tick_get64' and 'tick_get_us' functions can be called
+ *from the main loop, the tick callbacks and interrupts with not higher priority than TICK_TIMER.
+ *(They mask only the tick interrupt which can't stop a higher priority interrupt.)*/
+typedef struct _tick_tmr_t
+{
+    struct _tick_tmr_t * next;
+    struct _tick_tmr_t * prev;
+    void (*cb)(void * ctx);
+    void * ctx;
+    uint32_t expire;    /*Tick of the next call*/
+    uint32_t period;    /*0: one-shot*/
+    bool act;
+}tick_tmr_t;
+
+typedef struct
+{
+    uint32_t run;       /*Number of executions*/
+    uint32_t merged;    /*Posts while already pending (executed only once)*/
+    uint32_t lat_max;   /*Longest time from posting to execution [us]*/
+    uint32_t exec_max;  /*Longest execution [us]*/
+    uint64_t exec_sum;  /*Total execution time [us]*/
+}tick_work_stat_t;
+
+/*A deferred work item. The fields are private, see 'tick_work_...'*/
+typedef struct _tick_work_t
+{
+    struct _tick_work_t * next;
+    void (*fp)(void * ctx);
+    void * ctx;
+    uint64_t post_time; /*'tick_get_us' at posting*/
+    tick_work_stat_t stat;
+    bool pend;
+}tick_work_t;
 
 /**********************
  * GLOBAL PROTOTYPES
@@ -29,10 +63,26 @@
 void tick_init(void);
 void tick_wait_ms (uint32_t delay);
 void tick_wait_us (uint32_t delay);
+uint32_t tick_get_ms_loops(void);
+void tick_wait_loops(uint32_t n);
 uint32_t tick_get(void);
 uint32_t tick_elaps(uint32_t time_prev);
+uint64_t tick_get64(void);
+uint64_t tick_get_us(void);
+uint64_t tick_elaps_us(uint64_t time_prev);
+void tick_tmr_init(tick_tmr_t * tmr, void (*cb)(void *), void * ctx);
+void tick_tmr_start(tick_tmr_t * tmr, uint32_t delay, uint32_t period);
+void tick_tmr_stop(tick_tmr_t * tmr);
+bool tick_tmr_act(const tick_tmr_t * tmr);
+void tick_work_init(tick_work_t * work, void (*fp)(void *), void * ctx);
+bool tick_work_post(tick_work_t * work);
+uint32_t tick_work_run(void);
+void tick_work_get_stat(tick_work_t * work, tick_work_stat_t * st);
+void tick_work_clr_stat(tick_work_t * work);
 bool tick_add_func(void(*fp)(void));
 void tick_rem_func(void(*cb)(void));
+void tick_set_yield(void (*fp)(void));
+void tick_yield(void);
 
 /**********************
  *      MACROS
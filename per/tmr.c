@@ -62,6 +62,16 @@ hw_res_t tmr_set_period(tmr_t tmr, uint32_t p_us)
     return res;
 }
 
+/**
+ * Set the counter of a timer
+ * @param tmr the id of a timer (HW_TMRx)
+ * @param value the new value of the counter, 0: restart the period
+ */
+void tmr_set_value(tmr_t tmr, uint32_t value)
+{
+    psp_tmr_set_value(tmr, value);
+}
+
 /**
  * Set the callback function of a timer interrupt
  * @param tmr the id of a timer (HW_TMRx)
@@ -97,6 +107,83 @@ void tmr_en_int(tmr_t tmr, bool en)
     psp_tmr_en_int(tmr, en);
 }
 
+/**
+ * Get the elapsed time in the current period of a timer
+ * @param tmr the id of a timer (HW_TMRx)
+ * @return microseconds since the last period end (more than the period
+ *         if the interrupt of the last period is pending)
+ */
+uint32_t tmr_get_us(tmr_t tmr)
+{
+    return psp_tmr_get_us(tmr);
+}
+
+/**
+ * Start a PWM output. Its frequency is set by the period of the timer.
+ * The output pin has to be mapped to the channel by the application.
+ * @param tmr the id of a timer (HW_TMRx) as time base
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t tmr_pwm_init(tmr_t tmr, tmr_ch_t ch)
+{
+    if(tmr >= HW_TMR_NUM || ch >= HW_TMR_CH_NUM) return HW_RES_NOT_EX;
+
+    return psp_tmr_pwm_init(ch, tmr);
+}
+
+/**
+ * Set the duty cycle of a PWM output. Applied from the next period.
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param duty high time in 1/65536 of the period
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t tmr_pwm_set(tmr_ch_t ch, uint16_t duty)
+{
+    if(ch >= HW_TMR_CH_NUM) return HW_RES_NOT_EX;
+
+    return psp_tmr_pwm_set(ch, duty);
+}
+
+/**
+ * Stop a PWM output
+ * @param ch the id of a channel (HW_TMR_CHx)
+ */
+void tmr_pwm_stop(tmr_ch_t ch)
+{
+    if(ch >= HW_TMR_CH_NUM) return;
+
+    psp_tmr_pwm_stop(ch);
+}
+
+/**
+ * Start an input capture. The time of the edges are sent to a callback.
+ * The input pin has to be mapped to the channel by the application.
+ * @param tmr the id of a timer (HW_TMRx) as time base
+ * @param ch the id of a channel (HW_TMR_CHx)
+ * @param edge the edges to capture
+ * @param cb called with the time of every edge (from interrupt, TMR_IC_PRIO)
+ * @return HW_RES_OK or any error from hw_res_t
+ */
+hw_res_t tmr_ic_init(tmr_t tmr, tmr_ch_t ch, tmr_ic_edge_t edge, tmr_ic_cb_t cb)
+{
+    if(tmr >= HW_TMR_NUM || ch >= HW_TMR_CH_NUM) return HW_RES_NOT_EX;
+    if(cb == NULL) return HW_RES_INV_PARAM;
+
+    return psp_tmr_ic_init(ch, tmr, edge, cb);
+}
+
+/**
+ * Stop an input capture
+ * @param ch the id of a channel (HW_TMR_CHx)
+ */
+void tmr_ic_stop(tmr_ch_t ch)
+{
+    if(ch >= HW_TMR_CH_NUM) return;
+
+    psp_tmr_ic_stop(ch);
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -30,9 +30,16 @@
  **********************/
 void tmr_init(void);
 hw_res_t tmr_set_period(tmr_t tmr, uint32_t period);
+void tmr_set_value(tmr_t tmr, uint32_t value);
 void tmr_set_cb(tmr_t tmr, void (*cd) (void));
 void tmr_run(tmr_t tmr, bool en);
 void tmr_en_int(tmr_t tmr, bool en);
+uint32_t tmr_get_us(tmr_t tmr);
+hw_res_t tmr_pwm_init(tmr_t tmr, tmr_ch_t ch);
+hw_res_t tmr_pwm_set(tmr_ch_t ch, uint16_t duty);
+void tmr_pwm_stop(tmr_ch_t ch);
+hw_res_t tmr_ic_init(tmr_t tmr, tmr_ch_t ch, tmr_ic_edge_t edge, tmr_ic_cb_t cb);
+void tmr_ic_stop(tmr_ch_t ch);
 
 /**********************
  *      MACROS